@@ -6,9 +6,13 @@
 /***********************************************************/
 /***********************************************************/
 
-#define REPLY_BUFFER_LENGTH 8
+/* replies longer than a frame are fragmented */
+#define REPLY_BUFFER_LENGTH 32
 #define I2C_TX_DATA_LENGTH 8
 
+/* period of the subscription clock in milliseconds */
+#define SUBSCRIPTION_TICK_PERIOD 10
+
 /***********************************************************/
 /***********************************************************/
 
@@ -18,22 +22,6 @@ CFirmware CFirmware::_firmware;
 /* main function that runs the firmware */
 int main(void)
 {
-   /* FILE structs for fprintf */
-   FILE huart;
-
-   /* Set up FILE structs for fprintf */                           
-   fdev_setup_stream(&huart, 
-                     [](char c_to_write, FILE* pf_stream) {
-                        CFirmware::GetInstance().GetHUARTController().Write(c_to_write);
-                        return 1;
-                     },
-                     [](FILE* pf_stream) {
-                        return int(CFirmware::GetInstance().GetHUARTController().Read());
-                     },
-                     _FDEV_SETUP_RW);
-
-   CFirmware::GetInstance().SetFilePointer(&huart);
-
    /* Execute the firmware */
    CFirmware::GetInstance().Exec();
    /* Shutdown */
@@ -44,6 +32,25 @@ int main(void)
 /***********************************************************/
 
 void CFirmware::Exec() {
+   /* Stop the lift actuator from an interrupt as soon as an EMER_STOP_LIFT_ACTUATOR packet
+      without a sequence id is received, so that the stop does not wait for the main loop */
+   m_cPacketControlInterface.SetEmergencyPacket(CPacketControlInterface::CPacket::EType::EMER_STOP_LIFT_ACTUATOR,
+                                                nullptr,
+                                                0,
+                                                [] {
+      CFirmware::GetInstance().m_cLiftActuatorSystem.ProcessEvent(
+         CLiftActuatorSystem::ESystemEvent::STOP);
+   });
+
+   /* Measure the service time with the system timer */
+   m_cPacketControlInterface.SetClock([] {
+      return CFirmware::GetInstance().m_cTimer.GetMicroseconds();
+   });
+   /* timer 2 overflows every 256 ticks of 64 clock cycles */
+   m_cHUARTController.SetRxTimebase(m_cTimer.GetOverflowCounter(),
+                                    256,
+                                    64 / (F_CPU / 1000000UL));
+
    /* NFC Reset and Interrupt Signals */
    /* Enable pull up on IRQ line, drive one on RST line */
    PORTD |= (NFC_INT | NFC_RST);
@@ -59,244 +66,746 @@ void CFirmware::Exec() {
       m_cNFCController.ConfigureSAM() && 
       m_cNFCController.PowerDown();
 
-   uint8_t punReplyBuffer[REPLY_BUFFER_LENGTH];
-   uint8_t unRxBufferCount;
-      
+   UpdateTelemetry();
+   uint32_t unLastSubscriptionTick = m_cTimer.GetMilliseconds();
+
    for(;;) {
       /* step the lift actuator system state machine */
       m_cLiftActuatorSystem.Step();
+      /* refresh the telemetry, run the rules and step the subscriptions */
+      if(m_cTimer.GetMilliseconds() - unLastSubscriptionTick >= SUBSCRIPTION_TICK_PERIOD) {
+         unLastSubscriptionTick += SUBSCRIPTION_TICK_PERIOD;
+         UpdateTelemetry();
+         StepRules();
+         m_cPacketControlInterface.StepSubscriptions();
+      }
+      ExecScheduled();
+      ExecSubscriptions();
       /* check the PCI for input */
       m_cPacketControlInterface.ProcessInput();
       if(m_cPacketControlInterface.GetState() == CPacketControlInterface::EState::RECV_COMMAND) {
-         CPacketControlInterface::CPacket cPacket = m_cPacketControlInterface.GetPacket();
-         switch(cPacket.GetType()) {
-         case CPacketControlInterface::CPacket::EType::GET_UPTIME:
-            if(cPacket.GetDataLength() == 0) {
-               uint32_t unUptime = m_cTimer.GetMilliseconds();
-               uint8_t punTxData[] = {
-                  uint8_t((unUptime >> 24) & 0xFF),
-                  uint8_t((unUptime >> 16) & 0xFF),
-                  uint8_t((unUptime >> 8 ) & 0xFF),
-                  uint8_t((unUptime >> 0 ) & 0xFF)
-               };
-               m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_UPTIME,
-                                                    punTxData,
-                                                    4);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::GET_BATT_LVL:
-            if(cPacket.GetDataLength() == 0) {
-               uint8_t unBattLevel = CADCController::GetInstance().GetValue(CADCController::EChannel::ADC6);
-               m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_BATT_LVL,
-                                                    &unBattLevel,
-                                                    1);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::GET_CHARGER_STATUS:
-            if(cPacket.GetDataLength() == 0) {
-               uint8_t punTxData[] {
-                  uint8_t((PINC & PWR_MON_PGOOD) ? 0x00 : 0x01),
-                  uint8_t((PINC & PWR_MON_CHG) ? 0x00 : 0x01)
-               };
-               m_cPacketControlInterface.SendPacket(
-                  CPacketControlInterface::CPacket::EType::GET_CHARGER_STATUS,
-                  punTxData,
-                  sizeof(punTxData));
-            }
-            break;            
-         case CPacketControlInterface::CPacket::EType::SET_LIFT_ACTUATOR_POSITION:
-            /* Set the speed of the stepper motor */
-            if(cPacket.GetDataLength() == 1) {
-               const uint8_t* punRxData = cPacket.GetDataPointer();
-               m_cLiftActuatorSystem.SetPosition(punRxData[0]);
-               m_cLiftActuatorSystem.ProcessEvent(CLiftActuatorSystem::ESystemEvent::START_POSITION_CTRL);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::SET_LIFT_ACTUATOR_SPEED:
-            /* Set the speed of the stepper motor */
-            if(cPacket.GetDataLength() == 1) {
-               const uint8_t* punRxData = cPacket.GetDataPointer();
-               int8_t nSpeed = reinterpret_cast<const int8_t&>(punRxData[0]);
-               m_cLiftActuatorSystem.SetSpeed(nSpeed);
-               m_cLiftActuatorSystem.ProcessEvent(CLiftActuatorSystem::ESystemEvent::START_SPEED_CTRL);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::CALIBRATE_LIFT_ACTUATOR:
-            if(cPacket.GetDataLength() == 0) {
-               m_cLiftActuatorSystem.ProcessEvent(CLiftActuatorSystem::ESystemEvent::START_CALIBRATION);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::EMER_STOP_LIFT_ACTUATOR:
-            if(cPacket.GetDataLength() == 0) {
-               m_cLiftActuatorSystem.ProcessEvent(CLiftActuatorSystem::ESystemEvent::STOP);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::GET_LIFT_ACTUATOR_POSITION:
-            /* Set the speed of the stepper motor */
-            if(cPacket.GetDataLength() == 0) {
-               m_cPacketControlInterface.SendPacket(
-                  CPacketControlInterface::CPacket::EType::GET_LIFT_ACTUATOR_POSITION,
-                  m_cLiftActuatorSystem.GetPosition());
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::GET_LIFT_ACTUATOR_STATE:
-            /* Set the speed of the stepper motor */
-            if(cPacket.GetDataLength() == 0) {
-               m_cPacketControlInterface.SendPacket(
-                  CPacketControlInterface::CPacket::EType::GET_LIFT_ACTUATOR_STATE,
-                  static_cast<uint8_t>(m_cLiftActuatorSystem.GetSystemState()));
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::GET_LIMIT_SWITCH_STATE:
-            if(cPacket.GetDataLength() == 0) {
-               uint8_t punTxData[] {
-                  uint8_t(m_cLiftActuatorSystem.GetUpperLimitSwitchState() ? 0x01 : 0x00),
-                  uint8_t(m_cLiftActuatorSystem.GetLowerLimitSwitchState() ? 0x01 : 0x00)
-               };
-               m_cPacketControlInterface.SendPacket(
-                  CPacketControlInterface::CPacket::EType::GET_LIMIT_SWITCH_STATE,
-                  punTxData,
-                  sizeof(punTxData));
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::SET_EM_CHARGE_ENABLE:
-            if(cPacket.GetDataLength() == 1) {
-               const uint8_t* punRxData = cPacket.GetDataPointer();
-               if(punRxData[0] != 0) {
-                  m_cLiftActuatorSystem.GetElectromagnetController().SetChargeEnable(true);
-               } 
-               else {
-                  m_cLiftActuatorSystem.GetElectromagnetController().SetChargeEnable(false);
-               }
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::SET_EM_DISCHARGE_MODE:
-            if(cPacket.GetDataLength() == 1) {
-               const uint8_t* punRxData = cPacket.GetDataPointer();
-               switch(punRxData[0]) {
-               case 0: 
-                  m_cLiftActuatorSystem.GetElectromagnetController().SetDischargeMode(
-                     CElectromagnetController::EDischargeMode::CONSTRUCTIVE);
-                  break;
-               case 1: 
-                  m_cLiftActuatorSystem.GetElectromagnetController().SetDischargeMode(
-                     CElectromagnetController::EDischargeMode::DESTRUCTIVE);
-                  break;
-               default:
-                  m_cLiftActuatorSystem.GetElectromagnetController().SetDischargeMode(
-                     CElectromagnetController::EDischargeMode::DISABLE);
-                  break;
-               }
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::GET_EM_ACCUM_VOLTAGE:
-            if(cPacket.GetDataLength() == 0) {
-               uint8_t unAccumulatedVoltage = 
-                  m_cLiftActuatorSystem.GetElectromagnetController().GetAccumulatedVoltage();
-               m_cPacketControlInterface.SendPacket(
-                  CPacketControlInterface::CPacket::EType::GET_EM_ACCUM_VOLTAGE,
-                  &unAccumulatedVoltage,
-                  1);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::READ_SMBUS_BYTE:
-            if(cPacket.GetDataLength() == 1) {
-               uint8_t unAddress = cPacket.GetDataPointer()[0];
-               m_cTWController.Read(unAddress, 1, true);
-               punReplyBuffer[0] = m_cTWController.Read();
-               m_cPacketControlInterface.SendPacket(
-                  CPacketControlInterface::CPacket::EType::READ_SMBUS_BYTE,
-                  punReplyBuffer,
-                  1);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::WRITE_SMBUS_BYTE:
-            if(cPacket.GetDataLength() == 2) {
-               uint8_t unAddress = cPacket.GetDataPointer()[0];
-               uint8_t unData = cPacket.GetDataPointer()[1];
-               m_cTWController.BeginTransmission(unAddress);    
-               m_cTWController.Write(unData);
-               m_cTWController.EndTransmission(true);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::READ_SMBUS_BYTE_DATA:
-            if(cPacket.GetDataLength() == 2) {
-               uint8_t unAddress = cPacket.GetDataPointer()[0];
-               uint8_t unRegister = cPacket.GetDataPointer()[1];
-               m_cTWController.BeginTransmission(unAddress);    
-               m_cTWController.Write(unRegister);
-               m_cTWController.EndTransmission(false);
-               m_cTWController.Read(unAddress, 1, true);
-               punReplyBuffer[0] = m_cTWController.Read();
-               m_cPacketControlInterface.SendPacket(
-                  CPacketControlInterface::CPacket::EType::READ_SMBUS_BYTE_DATA,
-                  punReplyBuffer,
-                  1);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::WRITE_SMBUS_BYTE_DATA:
-            if(cPacket.GetDataLength() == 3) {
-               uint8_t unAddress = cPacket.GetDataPointer()[0];
-               uint8_t unRegister = cPacket.GetDataPointer()[1];
-               uint8_t unData = cPacket.GetDataPointer()[2];
-               m_cTWController.BeginTransmission(unAddress);
-               m_cTWController.Write(unRegister);
-               m_cTWController.Write(unData);
-               m_cTWController.EndTransmission(true);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::READ_SMBUS_WORD_DATA:
-            if(cPacket.GetDataLength() == 2) {
-               uint8_t unAddress = cPacket.GetDataPointer()[0];
-               uint8_t unRegister = cPacket.GetDataPointer()[1];
-               m_cTWController.BeginTransmission(unAddress);  
-               m_cTWController.Write(unRegister);
-               m_cTWController.EndTransmission(false);
-               m_cTWController.Read(unAddress, 2, true);
-               punReplyBuffer[0] = m_cTWController.Read();
-               punReplyBuffer[1] = m_cTWController.Read();
-               m_cPacketControlInterface.SendPacket(
-                  CPacketControlInterface::CPacket::EType::READ_SMBUS_WORD_DATA,
-                  punReplyBuffer,
-                  2);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::READ_SMBUS_I2C_BLOCK_DATA:
-            if(cPacket.GetDataLength() == 3) {
-               uint8_t unAddress = cPacket.GetDataPointer()[0];
-               uint8_t unRegister = cPacket.GetDataPointer()[1];
-               uint8_t unCount = cPacket.GetDataPointer()[2];
-               m_cTWController.BeginTransmission(unAddress);
-               m_cTWController.Write(unRegister);
-               m_cTWController.EndTransmission(false);
-               m_cTWController.Read(unAddress, unCount, true);
-               for(uint8_t unIndex = 0; unIndex < unCount; unIndex++) {
-                  punReplyBuffer[unIndex] = m_cTWController.Read();
-               }
-               m_cPacketControlInterface.SendPacket(
-                  CPacketControlInterface::CPacket::EType::READ_SMBUS_I2C_BLOCK_DATA,
-                  punReplyBuffer,
-                  unCount);
-            }
-            break;
-
-         case CPacketControlInterface::CPacket::EType::WRITE_NFC:
-            if(cPacket.HasData()) {
-               if(m_cNFCController.P2PInitiatorInit()) {
-                  unRxBufferCount = 
-                     m_cNFCController.P2PInitiatorTxRx(cPacket.GetDataPointer(),
-                                                       cPacket.GetDataLength(),
-                                                       punReplyBuffer,
-                                                       REPLY_BUFFER_LENGTH);
-               }
-               m_cNFCController.PowerDown();
-            }
-            break;
-         default:            
-            break;
-         }
+         m_cPacketControlInterface.BeginReply();
+         ExecPacket(m_cPacketControlInterface.GetPacket());
+         m_cPacketControlInterface.EndReply();
+      }
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::UpdateTelemetry() {
+   /* Run the analog to digital conversions into the back buffer and publish it */
+   STelemetry& sTelemetry = m_cTelemetry.GetBackBuffer();
+   sTelemetry.BattLvl =
+      CADCController::GetInstance().GetValue(CADCController::EChannel::ADC6);
+   sTelemetry.EMAccumVoltage =
+      m_cLiftActuatorSystem.GetElectromagnetController().GetAccumulatedVoltage();
+   sTelemetry.Timestamp = m_cTimer.GetMicroseconds();
+   m_cTelemetry.Swap();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecBatch(const CPacketControlInterface::CPacket& c_packet) {
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   m_cPacketControlInterface.BeginBatch();
+   /* execute each [type][length][data] record in order */
+   for(uint8_t unOffset = 0; unOffset + 2 <= c_packet.GetDataLength();) {
+      CPacketControlInterface::CPacket cSubPacket(punRxData[unOffset],
+                                                  punRxData[unOffset + 1],
+                                                  &punRxData[unOffset + 2]);
+      unOffset += 2 + cSubPacket.GetDataLength();
+      /* drop truncated records and nested batches */
+      if(unOffset > c_packet.GetDataLength() ||
+         cSubPacket.GetType() == CPacketControlInterface::CPacket::EType::BATCH) {
+         break;
       }
+      ExecPacket(cSubPacket);
+   }
+   m_cPacketControlInterface.EndBatch();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSubscriptions() {
+   CPacketControlInterface::CPacket cPacket(0xFF, 0, nullptr);
+   while(m_cPacketControlInterface.GetDueSubscription(cPacket)) {
+      ExecPacket(cPacket);
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecScheduled() {
+   CPacketControlInterface::CPacket cPacket(0xFF, 0, nullptr);
+   while(m_cPacketControlInterface.GetDueScheduled(cPacket)) {
+      ExecPacket(cPacket);
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+/* packet dispatch table, the dispatch index that maps the types to their handlers
+   is built from it at compile time */
+constexpr CPacketControlInterface::SHandler<CFirmware> CFirmware::m_psPacketHandlers[] PROGMEM = {
+   /* type, minimum and maximum data length, handler */
+   {CPacketControlInterface::CPacket::EType::GET_UPTIME, 0, 0, &CFirmware::ExecGetUptime},
+   {CPacketControlInterface::CPacket::EType::GET_BATT_LVL, 0, 0, &CFirmware::ExecGetBattLvl},
+   {CPacketControlInterface::CPacket::EType::BATCH, 0, REASSEMBLY_BUFFER_LENGTH, &CFirmware::ExecBatch},
+   {CPacketControlInterface::CPacket::EType::SUBSCRIBE, 2, 2, &CFirmware::ExecSubscribe},
+   {CPacketControlInterface::CPacket::EType::UNSUBSCRIBE, 0, 1, &CFirmware::ExecUnsubscribe},
+   {CPacketControlInterface::CPacket::EType::SET_FRAMING, 1, 1, &CFirmware::ExecSetFraming},
+   {CPacketControlInterface::CPacket::EType::GET_LINK_STATS, 0, 0, &CFirmware::ExecGetLinkStats},
+   {CPacketControlInterface::CPacket::EType::READ_RANGE, 2, 2, &CFirmware::ExecReadRange},
+   {CPacketControlInterface::CPacket::EType::WRITE_RANGE, 1, 1 + CONTROL_TABLE_SIZE, &CFirmware::ExecWriteRange},
+   {CPacketControlInterface::CPacket::EType::GET_CAPABILITIES, 0, 0, &CFirmware::ExecGetCapabilities},
+   {CPacketControlInterface::CPacket::EType::SET_REPLY_OPTIONS, 1, 1, &CFirmware::ExecSetReplyOptions},
+   {CPacketControlInterface::CPacket::EType::SET_BAUD, 4, 4, &CFirmware::ExecSetBaud},
+   {CPacketControlInterface::CPacket::EType::SCHEDULE, 0, SCHEDULE_HEADER_SIZE + SCHEDULE_DATA_LENGTH, &CFirmware::ExecSchedule},
+   {CPacketControlInterface::CPacket::EType::GET_CHARGER_STATUS, 0, 0, &CFirmware::ExecGetChargerStatus},
+   {CPacketControlInterface::CPacket::EType::SET_LIFT_ACTUATOR_POSITION, 1, 1, &CFirmware::ExecSetLiftActuatorPosition},
+   {CPacketControlInterface::CPacket::EType::GET_LIFT_ACTUATOR_POSITION, 0, 0, &CFirmware::ExecGetLiftActuatorPosition},
+   {CPacketControlInterface::CPacket::EType::SET_LIFT_ACTUATOR_SPEED, 1, 1, &CFirmware::ExecSetLiftActuatorSpeed},
+   {CPacketControlInterface::CPacket::EType::GET_LIMIT_SWITCH_STATE, 0, 0, &CFirmware::ExecGetLimitSwitchState},
+   {CPacketControlInterface::CPacket::EType::CALIBRATE_LIFT_ACTUATOR, 0, 0, &CFirmware::ExecCalibrateLiftActuator},
+   {CPacketControlInterface::CPacket::EType::EMER_STOP_LIFT_ACTUATOR, 0, 0, &CFirmware::ExecEmerStopLiftActuator},
+   {CPacketControlInterface::CPacket::EType::GET_LIFT_ACTUATOR_STATE, 0, 0, &CFirmware::ExecGetLiftActuatorState},
+   {CPacketControlInterface::CPacket::EType::SET_EM_CHARGE_ENABLE, 1, 1, &CFirmware::ExecSetEMChargeEnable},
+   {CPacketControlInterface::CPacket::EType::SET_EM_DISCHARGE_MODE, 1, 1, &CFirmware::ExecSetEMDischargeMode},
+   {CPacketControlInterface::CPacket::EType::GET_EM_ACCUM_VOLTAGE, 0, 0, &CFirmware::ExecGetEMAccumVoltage},
+   {CPacketControlInterface::CPacket::EType::WRITE_NFC, 1, NFC_CMD_BUF_LEN - 2, &CFirmware::ExecWriteNFC},
+   {CPacketControlInterface::CPacket::EType::READ_SMBUS_BYTE, 1, 1, &CFirmware::ExecReadSMBusByte},
+   {CPacketControlInterface::CPacket::EType::READ_SMBUS_BYTE_DATA, 2, 2, &CFirmware::ExecReadSMBusByteData},
+   {CPacketControlInterface::CPacket::EType::READ_SMBUS_WORD_DATA, 2, 2, &CFirmware::ExecReadSMBusWordData},
+   {CPacketControlInterface::CPacket::EType::READ_SMBUS_I2C_BLOCK_DATA, 3, 3, &CFirmware::ExecReadSMBusI2CBlockData},
+   {CPacketControlInterface::CPacket::EType::WRITE_SMBUS_BYTE, 2, 2, &CFirmware::ExecWriteSMBusByte},
+   {CPacketControlInterface::CPacket::EType::WRITE_SMBUS_BYTE_DATA, 3, 3, &CFirmware::ExecWriteSMBusByteData},
+   {CPacketControlInterface::CPacket::EType::SET_RULE, 2, 2 + RULE_PROGRAM_LENGTH, &CFirmware::ExecSetRule},
+   {CPacketControlInterface::CPacket::EType::GET_RULE_STATUS, 1, 1, &CFirmware::ExecGetRuleStatus}
+};
+
+static_assert(REASSEMBLY_BUFFER_LENGTH >= 1 + CONTROL_TABLE_SIZE &&
+              REASSEMBLY_BUFFER_LENGTH >= 2 + RULE_PROGRAM_LENGTH &&
+              REASSEMBLY_BUFFER_LENGTH >= NFC_CMD_BUF_LEN - 2 &&
+              REASSEMBLY_BUFFER_LENGTH >= SCHEDULE_HEADER_SIZE + SCHEDULE_DATA_LENGTH,
+              "a packet that is accepted does not fit into the reassembly buffer");
+
+/* control table fields, see CONTROL_TABLE_SIZE for the layout */
+const CPacketControlInterface::SField<CFirmware> CFirmware::m_psControlTable[] PROGMEM = {
+   /* address, size, read method, write method */
+   {0x00, 4, &CFirmware::ReadUptime, nullptr},
+   {0x04, 1, &CFirmware::ReadBattLvl, nullptr},
+   {0x05, 2, &CFirmware::ReadChargerStatus, nullptr},
+   {0x07, 1, &CFirmware::ReadLiftActuatorState, nullptr},
+   {0x08, 1, &CFirmware::ReadLiftActuatorPosition, &CFirmware::WriteLiftActuatorPosition},
+   {0x09, 2, &CFirmware::ReadLimitSwitchState, nullptr},
+   {0x0B, 1, &CFirmware::ReadEMAccumVoltage, nullptr}
+};
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecPacket(const CPacketControlInterface::CPacket& c_packet) {
+   /* packets of unknown type or with an invalid length are ignored */
+   CPacketControlInterface::Dispatch<CFirmware,
+                                     m_psPacketHandlers,
+                                     sizeof(m_psPacketHandlers) / sizeof(m_psPacketHandlers[0])>(*this, c_packet);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSubscribe(const CPacketControlInterface::CPacket& c_packet) {
+   /* Periodically execute a request, a period of zero removes the subscription */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   CPacketControlInterface::CPacket::EType eType =
+      static_cast<CPacketControlInterface::CPacket::EType>(punRxData[0]);
+   if(punRxData[1] == 0) {
+      m_cPacketControlInterface.Unsubscribe(eType);
+   }
+   else {
+      m_cPacketControlInterface.Subscribe(eType, punRxData[1]);
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecUnsubscribe(const CPacketControlInterface::CPacket& c_packet) {
+   /* Remove a single subscription, or all subscriptions if no type is given */
+   if(c_packet.GetDataLength() == 1) {
+      const uint8_t* punRxData = c_packet.GetDataPointer();
+      m_cPacketControlInterface.Unsubscribe(
+         static_cast<CPacketControlInterface::CPacket::EType>(punRxData[0]));
+   }
+   else {
+      m_cPacketControlInterface.UnsubscribeAll();
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetFraming(const CPacketControlInterface::CPacket& c_packet) {
+   /* Switch between the legacy and the COBS framing, takes effect after the reply */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   switch(punRxData[0]) {
+   case 0:
+      m_cPacketControlInterface.SetFraming(CPacketControlInterface::EFraming::LEGACY);
+      break;
+   case 1:
+      m_cPacketControlInterface.SetFraming(CPacketControlInterface::EFraming::COBS);
+      break;
+   default:
+      break;
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetReplyOptions(const CPacketControlInterface::CPacket& c_packet) {
+   /* Bit 0 enables the sample timestamps, bit 1 the service time measurement */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   m_cPacketControlInterface.SetReplyOptions(punRxData[0]);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetBaud(const CPacketControlInterface::CPacket& c_packet) {
+   /* Switch the link to [baud rate] after the reply, the host confirms the new rate by
+      sending a valid frame at it, otherwise the previous rate is restored */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   uint32_t unBaudRate = (uint32_t(punRxData[0]) << 24) | (uint32_t(punRxData[1]) << 16) |
+                         (uint32_t(punRxData[2]) << 8 ) | (uint32_t(punRxData[3]) << 0 );
+   bool bAccepted = m_cPacketControlInterface.SetBaudRate(unBaudRate);
+   uint8_t punTxData[] = {
+      uint8_t(bAccepted ? 0x01 : 0x00),
+      punRxData[0],
+      punRxData[1],
+      punRxData[2],
+      punRxData[3]
+   };
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::SET_BAUD,
+                                        punTxData,
+                                        sizeof(punTxData));
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSchedule(const CPacketControlInterface::CPacket& c_packet) {
+   /* Hold [execution time][type][data] until the execution time, the reply carries the
+      current time so that the host can estimate the offset between the clocks */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   bool bAccepted = false;
+   if(c_packet.GetDataLength() == 0) {
+      m_cPacketControlInterface.CancelScheduled();
+      bAccepted = true;
+   }
+   else if(c_packet.GetDataLength() >= SCHEDULE_HEADER_SIZE) {
+      uint32_t unTime = (uint32_t(punRxData[0]) << 24) | (uint32_t(punRxData[1]) << 16) |
+                        (uint32_t(punRxData[2]) << 8 ) | (uint32_t(punRxData[3]) << 0 );
+      bAccepted = m_cPacketControlInterface.Schedule(unTime,
+                                                     punRxData[4],
+                                                     &punRxData[SCHEDULE_HEADER_SIZE],
+                                                     c_packet.GetDataLength() - SCHEDULE_HEADER_SIZE);
+   }
+   uint32_t unTime = m_cPacketControlInterface.GetTime();
+   uint8_t punTxData[] = {
+      uint8_t(bAccepted ? 0x01 : 0x00),
+      uint8_t((unTime >> 24) & 0xFF),
+      uint8_t((unTime >> 16) & 0xFF),
+      uint8_t((unTime >> 8 ) & 0xFF),
+      uint8_t((unTime >> 0 ) & 0xFF)
+   };
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::SCHEDULE,
+                                        punTxData,
+                                        sizeof(punTxData));
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetRule(const CPacketControlInterface::CPacket& c_packet) {
+   /* Load [slot][instruction budget][bytecode], rejected rules are reported by GET_RULE_STATUS */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   m_cRuleEngine.Load(punRxData[0], punRxData[1], &punRxData[2], c_packet.GetDataLength() - 2);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetRuleStatus(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t unSlot = c_packet.GetDataPointer()[0];
+   if(unSlot < RULE_ENGINE_NUM_SLOTS) {
+      uint8_t punTxData[5];
+      m_cRuleEngine.GetStatus(unSlot, punTxData);
+      m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_RULE_STATUS,
+                                           punTxData,
+                                           sizeof(punTxData));
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::StepRules() {
+   m_cRuleEngine.Step(*this,
+                      m_psControlTable,
+                      sizeof(m_psControlTable) / sizeof(m_psControlTable[0]),
+                      &CFirmware::ExecPacket);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetLinkStats(const CPacketControlInterface::CPacket& c_packet) {
+   const CPacketControlInterface::SStatistics& sInterfaceStatistics =
+      m_cPacketControlInterface.GetStatistics();
+   CHUARTController::SStatistics sHUARTStatistics = m_cHUARTController.GetStatistics();
+   uint16_t punCounters[] = {
+      sInterfaceStatistics.Frames,
+      sInterfaceStatistics.ChecksumErrors,
+      sInterfaceStatistics.Resyncs,
+      sInterfaceStatistics.DiscardedBytes,
+      sHUARTStatistics.RxDrops,
+      sHUARTStatistics.RxOverruns,
+      sHUARTStatistics.ParityErrors,
+      sHUARTStatistics.FrameErrors,
+      sHUARTStatistics.TxRejects,
+      sHUARTStatistics.TxDrops,
+   };
+   uint8_t punTxData[sizeof(punCounters)];
+   for(uint8_t unIdx = 0; unIdx < sizeof(punCounters) / sizeof(punCounters[0]); unIdx++) {
+      punTxData[2 * unIdx] = uint8_t((punCounters[unIdx] >> 8) & 0xFF);
+      punTxData[2 * unIdx + 1] = uint8_t((punCounters[unIdx] >> 0) & 0xFF);
    }
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_LINK_STATS,
+                                        punTxData,
+                                        sizeof(punTxData));
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecReadRange(const CPacketControlInterface::CPacket& c_packet) {
+   /* Read [address][length] of the control table, the reply is [address][data] */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   uint8_t unAddress = punRxData[0];
+   uint8_t unLength = punRxData[1];
+   /* limit the range to the control table */
+   if(unAddress >= CONTROL_TABLE_SIZE) {
+      unLength = 0;
+   }
+   else if(unLength > CONTROL_TABLE_SIZE - unAddress) {
+      unLength = CONTROL_TABLE_SIZE - unAddress;
+   }
+   uint8_t punTxData[1 + CONTROL_TABLE_SIZE];
+   punTxData[0] = unAddress;
+   CPacketControlInterface::ReadRange(*this,
+                                      m_psControlTable,
+                                      sizeof(m_psControlTable) / sizeof(m_psControlTable[0]),
+                                      unAddress,
+                                      &punTxData[1],
+                                      unLength);
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::READ_RANGE,
+                                        punTxData,
+                                        1 + unLength);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecWriteRange(const CPacketControlInterface::CPacket& c_packet) {
+   /* Write [address][data] to the control table */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   CPacketControlInterface::WriteRange(*this,
+                                       m_psControlTable,
+                                       sizeof(m_psControlTable) / sizeof(m_psControlTable[0]),
+                                       punRxData[0],
+                                       &punRxData[1],
+                                       c_packet.GetDataLength() - 1);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetCapabilities(const CPacketControlInterface::CPacket& c_packet) {
+   /* Describe the firmware so that the host does not need to probe it */
+   uint32_t unBaudRate = m_cPacketControlInterface.GetBaudRate();
+   uint16_t unBaudRates = m_cPacketControlInterface.GetSupportedBaudRates();
+   uint8_t punTxData[CAPABILITIES_HEADER_SIZE + SUPPORTED_TYPES_BITMAP_SIZE] = {
+      uint8_t((uint32_t(FIRMWARE_BUILD_ID) >> 24) & 0xFF),
+      uint8_t((uint32_t(FIRMWARE_BUILD_ID) >> 16) & 0xFF),
+      uint8_t((uint32_t(FIRMWARE_BUILD_ID) >> 8 ) & 0xFF),
+      uint8_t((uint32_t(FIRMWARE_BUILD_ID) >> 0 ) & 0xFF),
+      BOARD_TYPE,
+      RX_COMMAND_BUFFER_LENGTH,
+      TX_COMMAND_BUFFER_LENGTH,
+      HUART_RX_BUFFER_SIZE,
+      HUART_TX_BUFFER_SIZE,
+      REASSEMBLY_BUFFER_LENGTH,
+      CONTROL_TABLE_SIZE,
+      uint8_t((unBaudRate >> 24) & 0xFF),
+      uint8_t((unBaudRate >> 16) & 0xFF),
+      uint8_t((unBaudRate >> 8 ) & 0xFF),
+      uint8_t((unBaudRate >> 0 ) & 0xFF),
+      uint8_t((unBaudRates >> 8) & 0xFF),
+      uint8_t((unBaudRates >> 0) & 0xFF),
+   };
+   CPacketControlInterface::GetSupportedTypes(m_psPacketHandlers,
+                                              sizeof(m_psPacketHandlers) / sizeof(m_psPacketHandlers[0]),
+                                              &punTxData[CAPABILITIES_HEADER_SIZE]);
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_CAPABILITIES,
+                                        punTxData,
+                                        sizeof(punTxData));
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetUptime(const CPacketControlInterface::CPacket& c_packet) {
+   uint32_t unUptime = m_cTimer.GetMilliseconds();
+   uint8_t punTxData[] = {
+      uint8_t((unUptime >> 24) & 0xFF),
+      uint8_t((unUptime >> 16) & 0xFF),
+      uint8_t((unUptime >> 8 ) & 0xFF),
+      uint8_t((unUptime >> 0 ) & 0xFF)
+   };
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_UPTIME,
+                                        punTxData,
+                                        4);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetBattLvl(const CPacketControlInterface::CPacket& c_packet) {
+   STelemetry sTelemetry = m_cTelemetry.Get();
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_BATT_LVL,
+                                        &sTelemetry.BattLvl,
+                                        1,
+                                        sTelemetry.Timestamp);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetChargerStatus(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t punTxData[] {
+      uint8_t((PINC & PWR_MON_PGOOD) ? 0x00 : 0x01),
+      uint8_t((PINC & PWR_MON_CHG) ? 0x00 : 0x01)
+   };
+   m_cPacketControlInterface.SendPacket(
+      CPacketControlInterface::CPacket::EType::GET_CHARGER_STATUS,
+      punTxData,
+      sizeof(punTxData),
+      m_cTimer.GetMicroseconds());
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetLiftActuatorPosition(const CPacketControlInterface::CPacket& c_packet) {
+   /* Set the position of the lift actuator */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   m_cLiftActuatorSystem.SetPosition(punRxData[0]);
+   m_cLiftActuatorSystem.ProcessEvent(CLiftActuatorSystem::ESystemEvent::START_POSITION_CTRL);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetLiftActuatorSpeed(const CPacketControlInterface::CPacket& c_packet) {
+   /* Set the speed of the stepper motor */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   int8_t nSpeed = reinterpret_cast<const int8_t&>(punRxData[0]);
+   m_cLiftActuatorSystem.SetSpeed(nSpeed);
+   m_cLiftActuatorSystem.ProcessEvent(CLiftActuatorSystem::ESystemEvent::START_SPEED_CTRL);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecCalibrateLiftActuator(const CPacketControlInterface::CPacket& c_packet) {
+   m_cLiftActuatorSystem.ProcessEvent(CLiftActuatorSystem::ESystemEvent::START_CALIBRATION);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecEmerStopLiftActuator(const CPacketControlInterface::CPacket& c_packet) {
+   m_cLiftActuatorSystem.ProcessEvent(CLiftActuatorSystem::ESystemEvent::STOP);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetLiftActuatorPosition(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t unPosition = m_cLiftActuatorSystem.GetPosition();
+   m_cPacketControlInterface.SendPacket(
+      CPacketControlInterface::CPacket::EType::GET_LIFT_ACTUATOR_POSITION,
+      &unPosition,
+      1,
+      m_cTimer.GetMicroseconds());
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetLiftActuatorState(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t unState = static_cast<uint8_t>(m_cLiftActuatorSystem.GetSystemState());
+   m_cPacketControlInterface.SendPacket(
+      CPacketControlInterface::CPacket::EType::GET_LIFT_ACTUATOR_STATE,
+      &unState,
+      1,
+      m_cTimer.GetMicroseconds());
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetLimitSwitchState(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t punTxData[] {
+      uint8_t(m_cLiftActuatorSystem.GetUpperLimitSwitchState() ? 0x01 : 0x00),
+      uint8_t(m_cLiftActuatorSystem.GetLowerLimitSwitchState() ? 0x01 : 0x00)
+   };
+   m_cPacketControlInterface.SendPacket(
+      CPacketControlInterface::CPacket::EType::GET_LIMIT_SWITCH_STATE,
+      punTxData,
+      sizeof(punTxData),
+      m_cTimer.GetMicroseconds());
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetEMChargeEnable(const CPacketControlInterface::CPacket& c_packet) {
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   if(punRxData[0] != 0) {
+      m_cLiftActuatorSystem.GetElectromagnetController().SetChargeEnable(true);
+   }
+   else {
+      m_cLiftActuatorSystem.GetElectromagnetController().SetChargeEnable(false);
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetEMDischargeMode(const CPacketControlInterface::CPacket& c_packet) {
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   switch(punRxData[0]) {
+   case 0:
+      m_cLiftActuatorSystem.GetElectromagnetController().SetDischargeMode(
+         CElectromagnetController::EDischargeMode::CONSTRUCTIVE);
+      break;
+   case 1:
+      m_cLiftActuatorSystem.GetElectromagnetController().SetDischargeMode(
+         CElectromagnetController::EDischargeMode::DESTRUCTIVE);
+      break;
+   default:
+      m_cLiftActuatorSystem.GetElectromagnetController().SetDischargeMode(
+         CElectromagnetController::EDischargeMode::DISABLE);
+      break;
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetEMAccumVoltage(const CPacketControlInterface::CPacket& c_packet) {
+   STelemetry sTelemetry = m_cTelemetry.Get();
+   m_cPacketControlInterface.SendPacket(
+      CPacketControlInterface::CPacket::EType::GET_EM_ACCUM_VOLTAGE,
+      &sTelemetry.EMAccumVoltage,
+      1,
+      sTelemetry.Timestamp);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecReadSMBusByte(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t punReplyBuffer[REPLY_BUFFER_LENGTH];
+   uint8_t unAddress = c_packet.GetDataPointer()[0];
+   m_cTWController.Read(unAddress, 1, true);
+   punReplyBuffer[0] = m_cTWController.Read();
+   m_cPacketControlInterface.SendPacket(
+      CPacketControlInterface::CPacket::EType::READ_SMBUS_BYTE,
+      punReplyBuffer,
+      1);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecWriteSMBusByte(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t unAddress = c_packet.GetDataPointer()[0];
+   uint8_t unData = c_packet.GetDataPointer()[1];
+   m_cTWController.BeginTransmission(unAddress);
+   m_cTWController.Write(unData);
+   m_cTWController.EndTransmission(true);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecReadSMBusByteData(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t punReplyBuffer[REPLY_BUFFER_LENGTH];
+   uint8_t unAddress = c_packet.GetDataPointer()[0];
+   uint8_t unRegister = c_packet.GetDataPointer()[1];
+   m_cTWController.BeginTransmission(unAddress);
+   m_cTWController.Write(unRegister);
+   m_cTWController.EndTransmission(false);
+   m_cTWController.Read(unAddress, 1, true);
+   punReplyBuffer[0] = m_cTWController.Read();
+   m_cPacketControlInterface.SendPacket(
+      CPacketControlInterface::CPacket::EType::READ_SMBUS_BYTE_DATA,
+      punReplyBuffer,
+      1);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecWriteSMBusByteData(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t unAddress = c_packet.GetDataPointer()[0];
+   uint8_t unRegister = c_packet.GetDataPointer()[1];
+   uint8_t unData = c_packet.GetDataPointer()[2];
+   m_cTWController.BeginTransmission(unAddress);
+   m_cTWController.Write(unRegister);
+   m_cTWController.Write(unData);
+   m_cTWController.EndTransmission(true);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecReadSMBusWordData(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t punReplyBuffer[REPLY_BUFFER_LENGTH];
+   uint8_t unAddress = c_packet.GetDataPointer()[0];
+   uint8_t unRegister = c_packet.GetDataPointer()[1];
+   m_cTWController.BeginTransmission(unAddress);
+   m_cTWController.Write(unRegister);
+   m_cTWController.EndTransmission(false);
+   m_cTWController.Read(unAddress, 2, true);
+   punReplyBuffer[0] = m_cTWController.Read();
+   punReplyBuffer[1] = m_cTWController.Read();
+   m_cPacketControlInterface.SendPacket(
+      CPacketControlInterface::CPacket::EType::READ_SMBUS_WORD_DATA,
+      punReplyBuffer,
+      2);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecReadSMBusI2CBlockData(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t punReplyBuffer[REPLY_BUFFER_LENGTH];
+   uint8_t unAddress = c_packet.GetDataPointer()[0];
+   uint8_t unRegister = c_packet.GetDataPointer()[1];
+   uint8_t unCount = c_packet.GetDataPointer()[2];
+   if(unCount > REPLY_BUFFER_LENGTH) {
+      unCount = REPLY_BUFFER_LENGTH;
+   }
+   m_cTWController.BeginTransmission(unAddress);
+   m_cTWController.Write(unRegister);
+   m_cTWController.EndTransmission(false);
+   m_cTWController.Read(unAddress, unCount, true);
+   for(uint8_t unIndex = 0; unIndex < unCount; unIndex++) {
+      punReplyBuffer[unIndex] = m_cTWController.Read();
+   }
+   m_cPacketControlInterface.SendPacket(
+      CPacketControlInterface::CPacket::EType::READ_SMBUS_I2C_BLOCK_DATA,
+      punReplyBuffer,
+      unCount);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecWriteNFC(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t punReplyBuffer[REPLY_BUFFER_LENGTH];
+   uint8_t unRxBufferCount;
+   if(m_cNFCController.P2PInitiatorInit()) {
+      unRxBufferCount =
+         m_cNFCController.P2PInitiatorTxRx(c_packet.GetDataPointer(),
+                                           c_packet.GetDataLength(),
+                                           punReplyBuffer,
+                                           REPLY_BUFFER_LENGTH);
+   }
+   m_cNFCController.PowerDown();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadUptime(uint8_t* pun_data) {
+   uint32_t unUptime = m_cTimer.GetMilliseconds();
+   pun_data[0] = uint8_t((unUptime >> 24) & 0xFF);
+   pun_data[1] = uint8_t((unUptime >> 16) & 0xFF);
+   pun_data[2] = uint8_t((unUptime >> 8 ) & 0xFF);
+   pun_data[3] = uint8_t((unUptime >> 0 ) & 0xFF);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadBattLvl(uint8_t* pun_data) {
+   pun_data[0] = m_cTelemetry.Get().BattLvl;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadChargerStatus(uint8_t* pun_data) {
+   pun_data[0] = (PINC & PWR_MON_PGOOD) ? 0x00 : 0x01;
+   pun_data[1] = (PINC & PWR_MON_CHG) ? 0x00 : 0x01;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadLiftActuatorState(uint8_t* pun_data) {
+   pun_data[0] = static_cast<uint8_t>(m_cLiftActuatorSystem.GetSystemState());
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadLiftActuatorPosition(uint8_t* pun_data) {
+   pun_data[0] = m_cLiftActuatorSystem.GetPosition();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::WriteLiftActuatorPosition(const uint8_t* pun_data) {
+   m_cLiftActuatorSystem.SetPosition(pun_data[0]);
+   m_cLiftActuatorSystem.ProcessEvent(CLiftActuatorSystem::ESystemEvent::START_POSITION_CTRL);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadLimitSwitchState(uint8_t* pun_data) {
+   pun_data[0] = m_cLiftActuatorSystem.GetUpperLimitSwitchState() ? 0x01 : 0x00;
+   pun_data[1] = m_cLiftActuatorSystem.GetLowerLimitSwitchState() ? 0x01 : 0x00;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadEMAccumVoltage(uint8_t* pun_data) {
+   pun_data[0] = m_cTelemetry.Get().EMAccumVoltage;
 }
 
 /***********************************************************/
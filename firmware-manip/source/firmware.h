@@ -21,6 +21,8 @@
 #include <lift_actuator_system.h>
 #include <packet_control_interface.h>
 #include <rf_controller.h>
+#include <snapshot.h>
+#include <rule_engine.h>
 
 #define PWR_MON_MASK   0x03
 #define PWR_MON_PGOOD  0x02
@@ -30,6 +32,22 @@
 #define NFC_INT        0x04
 #define NFC_RST        0x08
 
+/* reported by GET_CAPABILITIES, the build id is set by the Makefile */
+#define BOARD_TYPE 0x02
+#ifndef FIRMWARE_BUILD_ID
+#define FIRMWARE_BUILD_ID 0
+#endif
+
+/* control table of the manipulator, all fields are big endian
+   0x00 uint32_t   uptime in milliseconds
+   0x04 uint8_t    battery level
+   0x05 uint8_t[2] charger power good, charging
+   0x07 uint8_t    lift actuator state
+   0x08 uint8_t    lift actuator position (read/write, writing starts position control)
+   0x09 uint8_t[2] limit switches upper, lower
+   0x0B uint8_t    electromagnet accumulated voltage */
+#define CONTROL_TABLE_SIZE 0x0C
+
 class CFirmware {
 public:
       
@@ -37,10 +55,6 @@ public:
       return _firmware;
    }
 
-   void SetFilePointer(FILE* ps_huart) {
-      m_psHUART = ps_huart;
-   }
-
    CHUARTController& GetHUARTController() {
       return m_cHUARTController;
    }
@@ -57,10 +71,85 @@ public:
       return m_cTimer;
    }
 
+   /* Format ids of the LOG packets, the arguments are listed in brackets */
+   enum class ELogFormat : uint8_t {
+      NFC_NO_ACK          = 0x01, // [command]
+      NFC_REPLY_ERROR     = 0x02, // [command][reply id]
+      NFC_STATUS_ERROR    = 0x03, // [command][status]
+      NFC_TRANSMIT_ERROR  = 0x04, // [I2C error]
+      NFC_READ_TIMEOUT    = 0x05, // [I2C status]
+   };
+
+   void Log(ELogFormat e_format,
+            const uint8_t* pun_args = nullptr,
+            uint8_t un_num_args = 0) {
+      m_cPacketControlInterface.Log(static_cast<uint8_t>(e_format), pun_args, un_num_args);
+   }
+
    void Exec();
       
 private:
 
+   /* Packet handlers */
+   void ExecPacket(const CPacketControlInterface::CPacket& c_packet);
+   void ExecBatch(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSubscriptions();
+   void ExecScheduled();
+   void ExecSubscribe(const CPacketControlInterface::CPacket& c_packet);
+   void ExecUnsubscribe(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetFraming(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetReplyOptions(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetBaud(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSchedule(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetLinkStats(const CPacketControlInterface::CPacket& c_packet);
+   void ExecReadRange(const CPacketControlInterface::CPacket& c_packet);
+   void ExecWriteRange(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetCapabilities(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetRule(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetRuleStatus(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetUptime(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetBattLvl(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetChargerStatus(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetLiftActuatorPosition(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetLiftActuatorSpeed(const CPacketControlInterface::CPacket& c_packet);
+   void ExecCalibrateLiftActuator(const CPacketControlInterface::CPacket& c_packet);
+   void ExecEmerStopLiftActuator(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetLiftActuatorPosition(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetLiftActuatorState(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetLimitSwitchState(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetEMChargeEnable(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetEMDischargeMode(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetEMAccumVoltage(const CPacketControlInterface::CPacket& c_packet);
+   void ExecReadSMBusByte(const CPacketControlInterface::CPacket& c_packet);
+   void ExecWriteSMBusByte(const CPacketControlInterface::CPacket& c_packet);
+   void ExecReadSMBusByteData(const CPacketControlInterface::CPacket& c_packet);
+   void ExecWriteSMBusByteData(const CPacketControlInterface::CPacket& c_packet);
+   void ExecReadSMBusWordData(const CPacketControlInterface::CPacket& c_packet);
+   void ExecReadSMBusI2CBlockData(const CPacketControlInterface::CPacket& c_packet);
+   void ExecWriteNFC(const CPacketControlInterface::CPacket& c_packet);
+
+   /* Packet dispatch table */
+   static const CPacketControlInterface::SHandler<CFirmware> m_psPacketHandlers[];
+
+   /* Control table fields */
+   void ReadUptime(uint8_t* pun_data);
+   void ReadBattLvl(uint8_t* pun_data);
+   void ReadChargerStatus(uint8_t* pun_data);
+   void ReadLiftActuatorState(uint8_t* pun_data);
+   void ReadLiftActuatorPosition(uint8_t* pun_data);
+   void WriteLiftActuatorPosition(const uint8_t* pun_data);
+   void ReadLimitSwitchState(uint8_t* pun_data);
+   void ReadEMAccumVoltage(uint8_t* pun_data);
+
+   /* Control table */
+   static const CPacketControlInterface::SField<CFirmware> m_psControlTable[];
+
+   /* Refresh the telemetry snapshot */
+   void UpdateTelemetry();
+
+   /* Run the rules on the refreshed telemetry */
+   void StepRules();
+
    /* Test Routines */
    void TestPMIC();
    void TestDestructiveField();
@@ -107,14 +196,18 @@ private:
 
    CPacketControlInterface m_cPacketControlInterface;
 
-   static CFirmware _firmware;
-
-public: // TODO, don't make these public
-    /* File structs for fprintf */
-   FILE* m_psHUART;
-
+   /* Telemetry, refreshed once per subscription tick and copied into replies */
+   struct STelemetry {
+      uint8_t BattLvl;
+      uint8_t EMAccumVoltage;
+      uint32_t Timestamp;
+   };
+   CSnapshot<STelemetry> m_cTelemetry;
 
+   /* Reactions uploaded by the host */
+   CRuleEngine m_cRuleEngine;
 
+   static CFirmware _firmware;
 };
 
 #endif
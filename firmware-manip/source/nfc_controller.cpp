@@ -18,10 +18,6 @@ bool CNFCController::PowerDown() {
    m_punIOBuffer[2] = 0x01; // Generate an IRQ on wake up
    /* write command and check ack frame */
    if(!write_cmd_check_ack(m_punIOBuffer, 3)) {
-#ifdef DEBUG
-      fprintf(CFirmware::GetInstance().m_psHUART, 
-              "PN532 didn't send acknowledgement frame\r\n");
-#endif
       return false;
    }
 
@@ -30,19 +26,20 @@ bool CNFCController::PowerDown() {
    /* verify that the recieved data was a reply frame to given command */
    if(m_punIOBuffer[NFC_FRAME_DIRECTION_INDEX] != PN532_PN532TOHOST ||
       m_punIOBuffer[NFC_FRAME_ID_INDEX] - 1 != static_cast<uint8_t>(ECommand::POWERDOWN)) {
-#ifdef DEBUG
-      fprintf(CFirmware::GetInstance().m_psHUART, 
-              "Reply frame format error\r\n");
-#endif
+      uint8_t punArgs[] = {
+         static_cast<uint8_t>(ECommand::POWERDOWN),
+         m_punIOBuffer[NFC_FRAME_ID_INDEX]
+      };
+      CFirmware::GetInstance().Log(CFirmware::ELogFormat::NFC_REPLY_ERROR, punArgs, sizeof(punArgs));
       return false;
    }
    /* check the lower 6 bits of the status byte, error code 0x00 means success */
    if((m_punIOBuffer[NFC_FRAME_STATUS_INDEX] & 0x3F) != 0x00) {
-#ifdef DEBUG
-      fprintf(CFirmware::GetInstance().m_psHUART, 
-              "Status byte contained error: 0x%02x\r\n",
-              m_punIOBuffer[NFC_FRAME_STATUS_INDEX] & 0x3F);
-#endif
+      uint8_t punArgs[] = {
+         static_cast<uint8_t>(ECommand::POWERDOWN),
+         uint8_t(m_punIOBuffer[NFC_FRAME_STATUS_INDEX] & 0x3F)
+      };
+      CFirmware::GetInstance().Log(CFirmware::ELogFormat::NFC_STATUS_ERROR, punArgs, sizeof(punArgs));
       return false;
    }
    return true;
@@ -115,16 +112,9 @@ bool CNFCController::P2PInitiatorInit() {
     m_punIOBuffer[8] = 0x00;
 
     if(!write_cmd_check_ack(m_punIOBuffer, 9)) {
-#ifdef DEBUG
-       fprintf(CFirmware::GetInstance().m_psHUART, "InJumpForDEP send failed\n");
-#endif
        return false;
     }
 
-#ifdef DEBUG
-    fprintf(CFirmware::GetInstance().m_psHUART, "InJumpForDEP sent\n");
-#endif
-
     read_dt(m_punIOBuffer, 25);
 
     if(m_punIOBuffer[5] != PN532_PN532TOHOST) {
@@ -133,19 +123,16 @@ bool CNFCController::P2PInitiatorInit() {
     }
 
     if(m_punIOBuffer[NFC_FRAME_ID_INDEX] - 1 != static_cast<uint8_t>(ECommand::INJUMPFORDEP)) {
-#ifdef DEBUG
-       puthex(m_punIOBuffer, m_punIOBuffer[3] + 7);
-       fprintf(CFirmware::GetInstance().m_psHUART, "Initiator init failed");
-#endif
+       uint8_t punArgs[] = {
+          static_cast<uint8_t>(ECommand::INJUMPFORDEP),
+          m_punIOBuffer[NFC_FRAME_ID_INDEX]
+       };
+       CFirmware::GetInstance().Log(CFirmware::ELogFormat::NFC_REPLY_ERROR, punArgs, sizeof(punArgs));
        return false;
     }
     if(m_punIOBuffer[NFC_FRAME_ID_INDEX + 1]) {
        return false;
     }
-
-#ifdef DEBUG
-    fprintf(CFirmware::GetInstance().m_psHUART, "InJumpForDEP read success");
-#endif
     return true;
 }
 
@@ -208,9 +195,6 @@ bool CNFCController::P2PTargetInit() {
     if(!write_cmd_check_ack(m_punIOBuffer, 38)) {
        return false;
     }
-#ifdef DEBUG
-        fprintf(CFirmware::GetInstance().m_psHUART, "Target init sent\r\n");
-#endif
     read_dt(m_punIOBuffer, 24);
 
     if(m_punIOBuffer[5] != PN532_PN532TOHOST){
@@ -218,16 +202,13 @@ bool CNFCController::P2PTargetInit() {
     }
 
     if(m_punIOBuffer[NFC_FRAME_ID_INDEX] - 1 != static_cast<uint8_t>(ECommand::TGINITASTARGET)) {
-#ifdef DEBUG
-        puthex(m_punIOBuffer, m_punIOBuffer[3] + 7);
-        fprintf(CFirmware::GetInstance().m_psHUART, "Target init fail\r\n");
-#endif
+        uint8_t punArgs[] = {
+           static_cast<uint8_t>(ECommand::TGINITASTARGET),
+           m_punIOBuffer[NFC_FRAME_ID_INDEX]
+        };
+        CFirmware::GetInstance().Log(CFirmware::ELogFormat::NFC_REPLY_ERROR, punArgs, sizeof(punArgs));
         return false;
     }
-
-#ifdef DEBUG
-    fprintf(CFirmware::GetInstance().m_psHUART, "TgInitAsTarget read success\r\n");
-#endif
     return true;
 }
 
@@ -255,40 +236,30 @@ uint8_t CNFCController::P2PInitiatorTxRx(const uint8_t* pun_tx_buffer,
    if(!write_cmd_check_ack(m_punIOBuffer, un_tx_buffer_len + 2)){
       return 0;
    }
-#ifdef DEBUG
-   fprintf(CFirmware::GetInstance().m_psHUART, "Initiator DataExchange sent\r\n");
-#endif
 
    read_dt(m_punIOBuffer, 60);
    if(m_punIOBuffer[5] != PN532_PN532TOHOST){
       return 0;
    }
 
-#ifdef DEBUG
-   fprintf(CFirmware::GetInstance().m_psHUART, "Initiator DataExchange Get\r\n");
-#endif
-
    if(m_punIOBuffer[NFC_FRAME_ID_INDEX] - 1 != static_cast<uint8_t>(ECommand::INDATAEXCHANGE)){
-#ifdef DEBUG
-      puthex(m_punIOBuffer, m_punIOBuffer[3] + 7);
-      fprintf(CFirmware::GetInstance().m_psHUART, "Send data failed\r\n");
-#endif
+      uint8_t punArgs[] = {
+         static_cast<uint8_t>(ECommand::INDATAEXCHANGE),
+         m_punIOBuffer[NFC_FRAME_ID_INDEX]
+      };
+      CFirmware::GetInstance().Log(CFirmware::ELogFormat::NFC_REPLY_ERROR, punArgs, sizeof(punArgs));
       return 0;
    }
 
    if(m_punIOBuffer[NFC_FRAME_ID_INDEX + 1]) {
-#ifdef DEBUG
-      fprintf(CFirmware::GetInstance().m_psHUART,"InExchangeData Error: ");
-      puthex(m_punIOBuffer, m_punIOBuffer[3] + 7);
-      fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-#endif
+      uint8_t punArgs[] = {
+         static_cast<uint8_t>(ECommand::INDATAEXCHANGE),
+         m_punIOBuffer[NFC_FRAME_ID_INDEX + 1]
+      };
+      CFirmware::GetInstance().Log(CFirmware::ELogFormat::NFC_STATUS_ERROR, punArgs, sizeof(punArgs));
       return 0;
    }
 
-#ifdef DEBUG
-   puthex(m_punIOBuffer, m_punIOBuffer[3] + 7);
-   fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-#endif
    /* return number of read bytes */
    uint8_t unRxDataLength = m_punIOBuffer[3] - 3;
    memcpy(pun_rx_buffer, m_punIOBuffer + 8, (unRxDataLength > un_rx_buffer_len) ? un_rx_buffer_len : unRxDataLength);
@@ -322,27 +293,22 @@ uint8_t CNFCController::P2PTargetTxRx(const uint8_t* pun_tx_buffer,
    }
 
    if(m_punIOBuffer[NFC_FRAME_ID_INDEX] - 1 != static_cast<uint8_t>(ECommand::TGGETDATA)) {
-#ifdef DEBUG
-      puthex(m_punIOBuffer, 20);
-      fprintf(CFirmware::GetInstance().m_psHUART, "Target GetData failed\r\n");
-#endif
+      uint8_t punArgs[] = {
+         static_cast<uint8_t>(ECommand::TGGETDATA),
+         m_punIOBuffer[NFC_FRAME_ID_INDEX]
+      };
+      CFirmware::GetInstance().Log(CFirmware::ELogFormat::NFC_REPLY_ERROR, punArgs, sizeof(punArgs));
       return 0;
    }
    if(m_punIOBuffer[NFC_FRAME_ID_INDEX + 1]) {
-#ifdef DEBUG
-      fprintf(CFirmware::GetInstance().m_psHUART,"TgGetData Error:");
-      puthex(m_punIOBuffer, m_punIOBuffer[3]+7);
-      fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-#endif
+      uint8_t punArgs[] = {
+         static_cast<uint8_t>(ECommand::TGGETDATA),
+         m_punIOBuffer[NFC_FRAME_ID_INDEX + 1]
+      };
+      CFirmware::GetInstance().Log(CFirmware::ELogFormat::NFC_STATUS_ERROR, punArgs, sizeof(punArgs));
       return 0;
    }
 
-#ifdef DEBUG
-   fprintf(CFirmware::GetInstance().m_psHUART, "TgGetData: ");
-   puthex(m_punIOBuffer, m_punIOBuffer[3]+7);
-   fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-#endif
-
    /* read data */
    uint8_t unRxDataLength = m_punIOBuffer[3] - 3;
    memcpy(pun_rx_buffer, m_punIOBuffer + 8, (unRxDataLength > un_rx_buffer_len) ? un_rx_buffer_len : unRxDataLength);
@@ -359,10 +325,11 @@ uint8_t CNFCController::P2PTargetTxRx(const uint8_t* pun_tx_buffer,
       return 0;
    }
    if(m_punIOBuffer[NFC_FRAME_ID_INDEX] - 1 != static_cast<uint8_t>(ECommand::TGSETDATA)) {
-#ifdef DEBUG
-      puthex(m_punIOBuffer, 20);
-      fprintf(CFirmware::GetInstance().m_psHUART, "Send data failed\r\n");
-#endif
+      uint8_t punArgs[] = {
+         static_cast<uint8_t>(ECommand::TGSETDATA),
+         m_punIOBuffer[NFC_FRAME_ID_INDEX]
+      };
+      CFirmware::GetInstance().Log(CFirmware::ELogFormat::NFC_REPLY_ERROR, punArgs, sizeof(punArgs));
       return 0;
    }
    if(m_punIOBuffer[NFC_FRAME_ID_INDEX + 1]) {
@@ -385,41 +352,16 @@ uint8_t CNFCController::P2PTargetTxRx(const uint8_t* pun_tx_buffer,
 
 uint8_t CNFCController::write_cmd_check_ack(uint8_t *cmd, uint8_t len) {
     write_cmd(cmd, len);
-#ifdef DEBUG
-    fprintf(CFirmware::GetInstance().m_psHUART,"Checking for ACK frame\r\n");
-#endif
 
     // read acknowledgement
     if (!read_ack()) {
-#ifdef DEBUG
-       fprintf(CFirmware::GetInstance().m_psHUART, "No ACK frame received!\r\n");
-#endif
+       CFirmware::GetInstance().Log(CFirmware::ELogFormat::NFC_NO_ACK, cmd, 1);
        return false;
     }
     return true; // ack'd command
 }
 
 
-/*****************************************************************************/
-/*!
-	@brief  Send hexadecimal data through Serial with specified length.
-	@param  buf - pointer of data buffer.
-	@param  len - length need to send.
-	@return NONE
-*/
-/*****************************************************************************/
-void CNFCController::puthex(uint8_t data) {
-   fprintf(CFirmware::GetInstance().m_psHUART, "0x%02x ", data);
-}
-
-
-void CNFCController::puthex(uint8_t *buf, uint32_t len) {
-    for(uint32_t i = 0; i < len; i++)
-    {
-       fprintf(CFirmware::GetInstance().m_psHUART, "0x%02x ", buf[i]);
-    }
-}
-
 /*****************************************************************************/
 /*!
 	@brief  Write data frame to PN532.
@@ -434,10 +376,6 @@ void CNFCController::write_cmd(uint8_t *cmd, uint8_t len)
 
     len++;
 
-#ifdef DEBUG
-    fprintf(CFirmware::GetInstance().m_psHUART, "Sending: ");
-#endif
-
     CFirmware::GetInstance().GetTimer().Delay(2);     // or whatever the delay is for waking up the board
 
     // I2C START
@@ -453,22 +391,10 @@ void CNFCController::write_cmd(uint8_t *cmd, uint8_t len)
     CFirmware::GetInstance().GetTWController().Write(PN532_HOSTTOPN532);
     checksum += PN532_HOSTTOPN532;
 
-#ifdef DEBUG
-    puthex(PN532_PREAMBLE);
-    puthex(PN532_PREAMBLE);
-    puthex(PN532_STARTCODE2);
-    puthex((unsigned char)len);
-    puthex((unsigned char)(~len + 1));
-    puthex(PN532_HOSTTOPN532);
-#endif
-
     for (uint8_t i=0; i<len-1; i++)
     {
         if(CFirmware::GetInstance().GetTWController().Write(cmd[i])){
             checksum += cmd[i];
-#ifdef DEBUG
-            puthex(cmd[i]);
-#endif
         } else {
             i--;
             CFirmware::GetInstance().GetTimer().Delay(1);
@@ -480,14 +406,9 @@ void CNFCController::write_cmd(uint8_t *cmd, uint8_t len)
 
     // I2C STOP
     uint8_t err = CFirmware::GetInstance().GetTWController().EndTransmission();
-  
-#ifdef DEBUG
-    puthex(~checksum);
-    puthex(PN532_POSTAMBLE);
-    fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-    fprintf(CFirmware::GetInstance().m_psHUART, "EndTran returned %i\r\n", err);
-#endif
-
+    if(err != 0) {
+       CFirmware::GetInstance().Log(CFirmware::ELogFormat::NFC_TRANSMIT_ERROR, &err, 1);
+    }
 }
 
 /*****************************************************************************/
@@ -507,10 +428,6 @@ bool CNFCController::read_dt(uint8_t *buf, uint8_t len) {
       CFirmware::GetInstance().GetTWController().Read(PN532_I2C_ADDRESS, len + 2, true);
       // Read the status byte
       unStatus = CFirmware::GetInstance().GetTWController().Read();
-
-#ifdef DEBUG
-      fprintf(CFirmware::GetInstance().m_psHUART,"rdt: status = 0x%02x\r\n", unStatus);
-#endif
     
       if(unStatus == PN532_I2C_READY) {
          break;
@@ -524,19 +441,12 @@ bool CNFCController::read_dt(uint8_t *buf, uint8_t len) {
    }
 
    if(unStatus == PN532_I2C_READY) {
-
-#ifdef DEBUG
-      fprintf(CFirmware::GetInstance().m_psHUART,"Reading: ");
-#endif
       for(uint8_t i=0; i<len; i++) {
          buf[i] = CFirmware::GetInstance().GetTWController().Read();
-#ifdef DEBUG
-         puthex(buf[i]);
-#endif
       }
-#ifdef DEBUG
-      fprintf(CFirmware::GetInstance().m_psHUART,"\r\n");
-#endif
+   }
+   else {
+      CFirmware::GetInstance().Log(CFirmware::ELogFormat::NFC_READ_TIMEOUT, &unStatus, 1);
    }
    // Discard trailing 0x00 0x00
    // receive();
@@ -557,7 +467,6 @@ bool CNFCController::read_ack(void)
 
    read_dt(ack_buf, 6);
 
-   //    puthex(ack_buf, 6);
    //    Serial.println();
    return (memcmp(ack_buf, ack, 6) == 0);
 }
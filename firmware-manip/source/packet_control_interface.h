@@ -3,11 +3,19 @@
 
 #include <huart_controller.h>
 
+#include <avr/pgmspace.h>
+
 #define RX_COMMAND_BUFFER_LENGTH 32
 #define TX_COMMAND_BUFFER_LENGTH 32
 
+/* frames are validated in place, so a complete frame must fit into the receive ring */
+static_assert(HUART_RX_BUFFER_SIZE > RX_COMMAND_BUFFER_LENGTH, "the receive ring is too small");
+static_assert(HUART_TX_BUFFER_SIZE > TX_COMMAND_BUFFER_LENGTH, "the transmit ring is too small");
+
 #define PREAMBLE1  0xF0
 #define PREAMBLE2  0xCA
+/* alternative second preamble for frames with a sequence id */
+#define PREAMBLE2_SEQ 0xCB
 #define POSTAMBLE1 0x53
 #define POSTAMBLE2 0x0F
 
@@ -15,16 +23,84 @@
 #define TYPE_FIELD_SIZE 1
 #define DATA_LENGTH_FIELD_SIZE 1
 #define CHECKSUM_FIELD_SIZE 1
+#define SEQUENCE_FIELD_SIZE 1
 #define POSTAMBLE_SIZE 2
 
 #define NON_DATA_SIZE (PREAMBLE_SIZE + TYPE_FIELD_SIZE + DATA_LENGTH_FIELD_SIZE + \
                        CHECKSUM_FIELD_SIZE + POSTAMBLE_SIZE)
 
+#define SUBSCRIPTION_TABLE_LENGTH 4
+
+/* SCHEDULE packets of [execution time in microseconds, 4 bytes][type][data] hold a
+   packet until the clock reaches the execution time, the reply is [accepted][current
+   time, 4 bytes]. A SCHEDULE packet without data cancels all held packets */
+#define SCHEDULE_QUEUE_LENGTH 4
+#define SCHEDULE_HEADER_SIZE 5
+#define SCHEDULE_DATA_LENGTH 12
+
+/* SET_BAUD packets of [baud rate, 4 bytes] switch the link once the reply [accepted][baud
+   rate, 4 bytes] has been sent. The new rate is kept if a valid frame is received within
+   the timeout in microseconds, otherwise the previous rate is restored */
+#define BAUD_RATE_CONFIRM_TIMEOUT 1000000UL
+
+/* packets longer than a frame are sent as FRAGMENT packets of
+   [message id][index, bit 7 marks the last fragment][type][data] */
+#define FRAGMENT_HEADER_SIZE 3
+#define FRAGMENT_LAST_FLAG 0x80
+/* the longest packet that is accepted is a WRITE_NFC that fills the command buffer
+   of the NFC controller */
+#define REASSEMBLY_BUFFER_LENGTH 62
+
+/* GET_CAPABILITIES reply: [build id, 4 bytes][board type][receive, transmit, serial
+   receive, serial transmit and reassembly buffer lengths][control table size][baud rate,
+   4 bytes][supported baud rates bitmap, 2 bytes][supported types bitmap]. Board types are
+   0x01 sensor-actuator, 0x02 manipulator and 0x03 power management, only the power
+   management board reads the robot id and reports it after the board type. Bit n of the
+   supported baud rates bitmap stands for the nth rate of STANDARD_BAUD_RATES */
+#define CAPABILITIES_HEADER_SIZE 17
+#define SUPPORTED_TYPES_BITMAP_SIZE 32
+#define STANDARD_BAUD_RATES 2400UL, 4800UL, 9600UL, 14400UL, 19200UL, 28800UL, 38400UL, \
+   57600UL, 76800UL, 115200UL, 230400UL, 250000UL, 500000UL, 1000000UL
+
+/* the fragments of a packet are sent from ProcessInput as the transmit ring drains,
+   only one fragmented packet can be pending. The longest one is GET_CAPABILITIES */
+#define TX_MESSAGE_BUFFER_LENGTH (CAPABILITIES_HEADER_SIZE + SUPPORTED_TYPES_BITMAP_SIZE)
+
+/* options of SET_REPLY_OPTIONS: replies of sampled data are followed by the
+   time of sampling in microseconds as a big endian trailer */
+#define REPLY_OPTION_TIMESTAMP 0x01
+#define TIMESTAMP_FIELD_SIZE 4
+/* every packet is completed by an ACK of [type][receive dwell][service time], the
+   time in microseconds between the arrival of the end of the frame and parsing
+   it, and between parsing it and completing the reply. Requires a clock */
+#define REPLY_OPTION_SERVICE_TIME 0x02
+#define SERVICE_TIME_ACK_SIZE 9
+
+/* largest field of a control table */
+#define CONTROL_FIELD_MAX_SIZE 16
+
 #define TYPE_OFFSET 2
 #define DATA_LENGTH_OFFSET 3
 #define DATA_START_OFFSET 4
+/* frames with a sequence id carry it in front of the data */
+#define SEQUENCE_OFFSET 4
 #define CHECKSUM_OFFSET -3
 
+/* COBS framing: [type][length][sequence id, optional][data][checksum] is encoded
+   with consistent overhead byte stuffing and terminated by a zero delimiter */
+#define COBS_DELIMITER 0x00
+#define COBS_MAX_ENCODED_LENGTH (RX_COMMAND_BUFFER_LENGTH - PREAMBLE_SIZE - POSTAMBLE_SIZE + \
+                                 SEQUENCE_FIELD_SIZE + 1)
+
+/* frames are encoded completely before they are queued */
+static_assert(TX_COMMAND_BUFFER_LENGTH >= COBS_MAX_ENCODED_LENGTH + 1, "a COBS frame does not fit into the frame buffer");
+/* received frames are moved into the receive buffer together with their delimiter */
+static_assert(RX_COMMAND_BUFFER_LENGTH >= COBS_MAX_ENCODED_LENGTH + 1, "a COBS frame does not fit into the receive buffer");
+
+/* longest data of a packet that is matched by the receive interrupt, see SetEmergencyPacket */
+#define EMERGENCY_DATA_LENGTH 2
+#define EMERGENCY_FRAME_LENGTH (NON_DATA_SIZE + EMERGENCY_DATA_LENGTH)
+
 class CPacketControlInterface {
 
 public:
@@ -35,14 +111,45 @@ public:
       SRCH_POSTAMBLE2,
       RECV_COMMAND,
       BUF_OVERFLOW,
+      /* COBS framing */
+      SRCH_DELIMITER,
+      SKIP_FRAME,
    }; 
 
+   /* receive statistics, the counters wrap around */
+   struct SStatistics {
+      uint16_t Frames;
+      uint16_t ChecksumErrors;
+      uint16_t Resyncs;
+      uint16_t DiscardedBytes;
+   };
+
+   enum class EFraming : uint8_t {
+      LEGACY = 0,
+      COBS = 1,
+   };
+
    class CPacket {
    public:
       
       enum class EType : uint8_t {
          GET_UPTIME = 0x00,
          GET_BATT_LVL = 0x01,
+         /* Protocol Packets */
+         BATCH = 0x02,
+         SUBSCRIBE = 0x03,
+         UNSUBSCRIBE = 0x04,
+         ACK = 0x05,
+         SET_FRAMING = 0x06,
+         GET_LINK_STATS = 0x07,
+         FRAGMENT = 0x08,
+         READ_RANGE = 0x09,
+         WRITE_RANGE = 0x0A,
+         LOG = 0x0B,
+         GET_CAPABILITIES = 0x0C,
+         SET_REPLY_OPTIONS = 0x0D,
+         SET_BAUD = 0x0E,
+         SCHEDULE = 0x0F,
 
          /*************************************/
          /* Sensor-Actuator Microcontroller   */
@@ -53,6 +160,9 @@ public:
          GET_DDS_SPEED  = 0x13,
          SET_DDS_PARAMS = 0x14,
          GET_DDS_PARAMS = 0x15,
+         /* [samples per frame][keyframe interval][options] configures the stream,
+            which is sent as delta encoded frames, see delta_stream.h */
+         DDS_SPEED_STREAM = 0x16,
          /* Accelerometer System Packets */
          GET_ACCEL_READING = 0x20,
 
@@ -103,6 +213,12 @@ public:
 	      WRITE_SMBUS_BLOCK_DATA = 0xD3,
          WRITE_SMBUS_I2C_BLOCK_DATA = 0xD4,
          /*************************************/
+         /* Rule Engine                       */
+         /*************************************/
+         /* [slot][instruction budget][bytecode], see rule_engine.h */
+         SET_RULE = 0xE0,
+         GET_RULE_STATUS = 0xE1,
+         /*************************************/
          /* Invalid value for conversions     */
          /*************************************/
          INVALID = 0xFF
@@ -112,12 +228,15 @@ public:
 
       CPacket(uint8_t un_type_id,
               uint8_t un_data_length,
-              uint8_t* pun_data) :
+              const uint8_t* pun_data) :
          m_unTypeId(un_type_id),
          m_unDataLength(un_data_length),
          m_punData(pun_data) {}
       
+      /* the type is not validated, unknown types are rejected by the dispatch table */
       EType GetType() const;
+
+      uint8_t GetTypeId() const;
       
       bool HasData() const;
       uint8_t GetDataLength() const;
@@ -126,15 +245,204 @@ public:
    private: 
       uint8_t m_unTypeId;
       uint8_t m_unDataLength;
-      uint8_t* m_punData;
+      const uint8_t* m_punData;
+   };
+
+   /* entry of a dispatch table in program memory, each type may appear only once */
+   template<class T>
+   struct SHandler {
+      CPacket::EType Type;
+      uint8_t MinDataLength;
+      uint8_t MaxDataLength;
+      void (T::*Method)(const CPacket& c_packet);
+   };
+
+   /* sequence of the values 0 to UN_COUNT - 1 as template arguments */
+   template<uint16_t... UN_VALUES>
+   struct SSequence {};
+
+   template<uint16_t UN_COUNT, uint16_t... UN_VALUES>
+   struct SMakeSequence : SMakeSequence<UN_COUNT - 1, UN_COUNT - 1, UN_VALUES...> {};
+
+   template<uint16_t... UN_VALUES>
+   struct SMakeSequence<0, UN_VALUES...> {
+      typedef SSequence<UN_VALUES...> Sequence;
    };
 
+   /* maps each type id to the slot of its handler in a dispatch table, or to NO_SLOT
+      if the type has no handler. The map is built by the compiler, which requires the
+      dispatch table to be defined constexpr, and is kept in program memory */
+   template<class T, const SHandler<T>* PS_TABLE, uint8_t UN_TABLE_LENGTH>
+   struct SDispatchIndex {
+      static const uint8_t NO_SLOT = 0xFF;
+
+      static constexpr uint8_t FindSlot(uint8_t un_type, uint8_t un_slot) {
+         return (un_slot == UN_TABLE_LENGTH) ? NO_SLOT :
+            (static_cast<uint8_t>(PS_TABLE[un_slot].Type) == un_type) ?
+               un_slot : FindSlot(un_type, un_slot + 1);
+      }
+
+      static constexpr bool IsUnique(uint8_t un_slot) {
+         return (un_slot == UN_TABLE_LENGTH) ||
+            (FindSlot(static_cast<uint8_t>(PS_TABLE[un_slot].Type), 0) == un_slot &&
+             IsUnique(un_slot + 1));
+      }
+
+      template<class S>
+      struct SMap;
+
+      template<uint16_t... UN_TYPES>
+      struct SMap<SSequence<UN_TYPES...> > {
+         static const uint8_t Slots[sizeof...(UN_TYPES)];
+      };
+
+      typedef SMap<typename SMakeSequence<UINT8_MAX + 1>::Sequence> Map;
+   };
+
+   /* looks up the handler of a packet in the map of its type and checks the length of
+      its data. Returns false if the type is unknown or the length is invalid */
+   template<class T, const SHandler<T>* PS_TABLE, uint8_t UN_TABLE_LENGTH>
+   static bool Dispatch(T& c_target,
+                        const CPacket& c_packet) {
+      typedef SDispatchIndex<T, PS_TABLE, UN_TABLE_LENGTH> SIndex;
+      static_assert(UN_TABLE_LENGTH < SIndex::NO_SLOT, "the dispatch table is too long");
+      static_assert(SIndex::IsUnique(0), "a type appears twice in the dispatch table");
+      uint8_t unSlot = pgm_read_byte(&SIndex::Map::Slots[c_packet.GetTypeId()]);
+      if(unSlot == SIndex::NO_SLOT) {
+         return false;
+      }
+      SHandler<T> sHandler;
+      memcpy_P(&sHandler, &PS_TABLE[unSlot], sizeof(SHandler<T>));
+      if(c_packet.GetDataLength() < sHandler.MinDataLength ||
+         c_packet.GetDataLength() > sHandler.MaxDataLength) {
+         return false;
+      }
+      (c_target.*sHandler.Method)(c_packet);
+      return true;
+   }
+
+   /* sets bit (type % 8) of byte (type / 8) in the bitmap for each type in the table */
+   template<class T>
+   static void GetSupportedTypes(const SHandler<T>* ps_table,
+                                 uint8_t un_table_length,
+                                 uint8_t* pun_bitmap) {
+      for(uint8_t unIdx = 0; unIdx < SUPPORTED_TYPES_BITMAP_SIZE; unIdx++) {
+         pun_bitmap[unIdx] = 0;
+      }
+      for(uint8_t unIdx = 0; unIdx < un_table_length; unIdx++) {
+         uint8_t unType = pgm_read_byte(&ps_table[unIdx].Type);
+         pun_bitmap[unType >> 3] |= (1 << (unType & 0x07));
+      }
+   }
+
+   /* field of a control table in program memory. Fields are big endian, the
+      write method is nullptr for read-only fields */
+   template<class T>
+   struct SField {
+      uint8_t Address;
+      uint8_t Size;
+      void (T::*Read)(uint8_t* pun_data);
+      void (T::*Write)(const uint8_t* pun_data);
+   };
+
+   /* reads an address range of a control table into pun_data, bytes that are
+      not mapped to a field read as zero */
+   template<class T>
+   static void ReadRange(T& c_target,
+                         const SField<T>* ps_table,
+                         uint8_t un_table_length,
+                         uint8_t un_address,
+                         uint8_t* pun_data,
+                         uint8_t un_length) {
+      for(uint8_t unIdx = 0; unIdx < un_length; unIdx++) {
+         pun_data[unIdx] = 0;
+      }
+      for(uint8_t unFieldIdx = 0; unFieldIdx < un_table_length; unFieldIdx++) {
+         SField<T> sField;
+         memcpy_P(&sField, &ps_table[unFieldIdx], sizeof(SField<T>));
+         /* skip fields outside of the range */
+         if(sField.Address + sField.Size <= un_address ||
+            sField.Address >= un_address + un_length) {
+            continue;
+         }
+         uint8_t punField[CONTROL_FIELD_MAX_SIZE];
+         (c_target.*sField.Read)(punField);
+         for(uint8_t unIdx = 0; unIdx < sField.Size; unIdx++) {
+            uint8_t unAddress = sField.Address + unIdx;
+            if(unAddress >= un_address && unAddress < un_address + un_length) {
+               pun_data[unAddress - un_address] = punField[unIdx];
+            }
+         }
+      }
+   }
+
+   /* writes the fields of a control table that are completely inside the
+      address range, other fields are left unchanged */
+   template<class T>
+   static void WriteRange(T& c_target,
+                          const SField<T>* ps_table,
+                          uint8_t un_table_length,
+                          uint8_t un_address,
+                          const uint8_t* pun_data,
+                          uint8_t un_length) {
+      for(uint8_t unFieldIdx = 0; unFieldIdx < un_table_length; unFieldIdx++) {
+         SField<T> sField;
+         memcpy_P(&sField, &ps_table[unFieldIdx], sizeof(SField<T>));
+         if(sField.Write != nullptr &&
+            sField.Address >= un_address &&
+            sField.Address + sField.Size <= un_address + un_length) {
+            (c_target.*sField.Write)(&pun_data[sField.Address - un_address]);
+         }
+      }
+   }
+
 public:
    CPacketControlInterface(CHUARTController& c_controller) :
       m_eState(EState::SRCH_PREAMBLE1),
-      m_unRxBufferPointer(0),
-      m_unUsedBufferLength(0),
-      m_unReparseOffset(RX_COMMAND_BUFFER_LENGTH),
+      m_unFrameLength(0),
+      m_eFraming(EFraming::LEGACY),
+      m_eNextFraming(EFraming::LEGACY),
+      m_bRxSequence(false),
+      m_unRxSequence(0),
+      m_bReplyActive(false),
+      m_bReplySequence(false),
+      m_bReplySent(false),
+      m_unReplySequence(0),
+      m_unReplyType(0),
+      m_unReplyOptions(0),
+      m_pfClock(nullptr),
+      m_unRxDwell(0),
+      m_unReplyStartTime(0),
+      m_unEmergencyType(0),
+      m_unEmergencyDataLength(0),
+      m_pfEmergencyHandler(nullptr),
+      m_bBatchActive(false),
+      m_bBatchPending(false),
+      m_bBatchSequence(false),
+      m_unBatchSequence(0),
+      m_unBatchLength(0),
+      m_psSubscriptions(),
+      m_psScheduledPackets(),
+      m_eBaudRateSwitch(EBaudRateSwitch::IDLE),
+      m_unBaudRate(HUART_BAUD_RATE),
+      m_unNextBaudRate(HUART_BAUD_RATE),
+      m_unFallbackBaudRate(HUART_BAUD_RATE),
+      m_unBaudRateSwitchTime(0),
+      m_unBaudRateSwitchFrames(0),
+      m_sStatistics(),
+      m_unTxMessageId(0),
+      m_bTxMessagePending(false),
+      m_bTxMessageSequence(false),
+      m_unTxMessageSequence(0),
+      m_unTxMessageType(0),
+      m_unTxMessageIndex(0),
+      m_unTxMessageOffset(0),
+      m_unTxMessageLength(0),
+      m_unTxMessageChunkLength(0),
+      m_unReassemblyId(0),
+      m_unReassemblyType(0),
+      m_unReassemblyIndex(0),
+      m_unReassemblyLength(0),
       m_cPacket(0xFF, 0, 0),
       m_cController(c_controller) {}
 
@@ -148,35 +456,245 @@ public:
 
    void Reset();
 
-   void SendPacket(CPacket::EType e_type,
+   /* selects the framing of the following packets, the reply to the current
+      packet is still sent with the current framing */
+   void SetFraming(EFraming e_framing);
+
+   EFraming GetFraming() const;
+
+   const SStatistics& GetStatistics() const;
+
+   void SetReplyOptions(uint8_t un_options);
+
+   uint8_t GetReplyOptions() const;
+
+   /* clock in microseconds for the service time measurement, the receive dwell
+      is measured with the timebase that is set in the controller */
+   void SetClock(uint32_t (*pf_clock)());
+
+   /* pf_handler is run by the receive interrupt of the controller as soon as a frame
+      of the packet has been received, the packet is then also executed as usual. The
+      frame is matched in the current framing, it must start right after the end of
+      the previous frame and must not have a sequence id, such packets are only
+      executed by the main loop. A nullptr handler disables the matching */
+   void SetEmergencyPacket(CPacket::EType e_type,
+                           const uint8_t* pun_data,
+                           uint8_t un_data_length,
+                           void (*pf_handler)());
+
+   /* the packets are queued without blocking. Returns false if the packet was
+      dropped because it is too long or the transmit ring is full, the caller
+      may then try again later */
+   bool SendPacket(CPacket::EType e_type,
                    const uint8_t* pun_tx_data,
                    uint8_t un_tx_data_length);
                    
-   void SendPacket(CPacket::EType e_type,
+   bool SendPacket(CPacket::EType e_type,
                    uint8_t un_tx_data) {
-      SendPacket(e_type, &un_tx_data, 1);                
+      return SendPacket(e_type, &un_tx_data, 1);                
    }
    
-   void SendPacket(CPacket::EType e_type) {
-      SendPacket(e_type, nullptr, 0);                
+   bool SendPacket(CPacket::EType e_type) {
+      return SendPacket(e_type, nullptr, 0);                
    }
 
+   /* sends a packet of sampled data, the time of sampling is appended if
+      timestamps are enabled and the packet still fits into a frame */
+   bool SendPacket(CPacket::EType e_type,
+                   const uint8_t* pun_tx_data,
+                   uint8_t un_tx_data_length,
+                   uint32_t un_timestamp);
+
+   /* sends a LOG packet with a format id and binary arguments which are decoded
+      by the host. Log packets are never batched, fragmented or tagged with the
+      sequence id of a reply and are dropped if the transmit ring is full. Must
+      not be called from an interrupt */
+   void Log(uint8_t un_format_id,
+            const uint8_t* pun_args = nullptr,
+            uint8_t un_num_args = 0);
+
+   /* while a reply is active, all sent packets echo the sequence id of the received
+      packet. If it had a sequence id and no packet was sent, EndReply sends an ACK.
+      ProcessInput only returns a packet once the transmit ring can take a complete
+      frame, EndReply returns false if the ACK was dropped nevertheless */
+   void BeginReply();
+
+   bool EndReply();
+
+   /* while a batch is active, SendPacket appends the packet as a [type][length][data]
+      record to a single BATCH reply which is sent by EndBatch. If the transmit ring is
+      full, the reply is deferred and input is held until ProcessInput has sent it */
+   void BeginBatch();
+
+   void EndBatch();
+
+   /* subscriptions periodically replay a zero-length request of the given type,
+      the period is in ticks of the board's telemetry clock */
+   bool Subscribe(CPacket::EType e_type, uint8_t un_period);
+
+   void Unsubscribe(CPacket::EType e_type);
+
+   void UnsubscribeAll();
+
+   void StepSubscriptions();
+
+   bool GetDueSubscription(CPacket& c_packet);
+
+   /* holds a packet until the clock reaches un_time. Returns false if the queue is
+      full, the packet is too long or can not be scheduled, or no clock is set */
+   bool Schedule(uint32_t un_time, uint8_t un_type, const uint8_t* pun_data, uint8_t un_length);
+
+   void CancelScheduled();
+
+   /* returns the earliest held packet that is due, its data is valid until the
+      next call to Schedule */
+   bool GetDueScheduled(CPacket& c_packet);
+
+   /* current time of the clock, zero if no clock is set */
+   uint32_t GetTime();
+
+   /* switches the link to the baud rate once the transmitter is idle, see SET_BAUD.
+      Returns false if the rate is not supported or no clock is set */
+   bool SetBaudRate(uint32_t un_baud_rate);
+
+   uint32_t GetBaudRate() const;
+
+   /* bitmap of the rates of STANDARD_BAUD_RATES that SetBaudRate accepts */
+   uint16_t GetSupportedBaudRates();
+
 private:
-   uint8_t ComputeChecksum(uint8_t* pun_buf_data, uint8_t un_buf_length);
-   void AdjustRxBuffer();
-   void ReceiveFrame(uint8_t *pun_data, uint8_t un_length);
+   void ReceiveFrame();
+   void ReceiveCOBSFrame();
+   void ReleaseFrame();
+   void Resynchronize();
+   void StepBaudRate();
+   bool Reassemble();
+   void StepTxMessage();
+   void ArmRxInterrupt();
+   bool WriteMessage(CPacket::EType e_type,
+                     const uint8_t* pun_tx_data,
+                     uint8_t un_tx_data_length);
+   bool WriteFrame(CPacket::EType e_type,
+                   const uint8_t* pun_tx_data,
+                   uint8_t un_tx_data_length);
+   bool WriteFrame(CPacket::EType e_type,
+                   const uint8_t* pun_tx_data,
+                   uint8_t un_tx_data_length,
+                   bool b_sequence,
+                   uint8_t un_sequence);
+   /* writes the complete frame in the current framing to pun_frame and returns its length */
+   uint8_t EncodeFrame(CPacket::EType e_type,
+                       const uint8_t* pun_tx_data,
+                       uint8_t un_tx_data_length,
+                       bool b_sequence,
+                       uint8_t un_sequence,
+                       uint8_t* pun_frame) const;
 
    EState m_eState;
 
-   uint8_t m_unRxBufferPointer;
-   uint8_t m_unUsedBufferLength;
-   uint8_t m_unReparseOffset;
+   /* length of the frame at the head of the receive ring */
+   uint8_t m_unFrameLength;
+   EFraming m_eFraming;
+   EFraming m_eNextFraming;
+   /* sequence id of the received frame */
+   bool m_bRxSequence;
+   uint8_t m_unRxSequence;
+   /* payloads are referenced directly inside the receive ring, this buffer
+      is only used for payloads that wrap around the end of the ring and for
+      decoding COBS frames */
    uint8_t m_punRxBuffer[RX_COMMAND_BUFFER_LENGTH];
+
+   /* sequence id echoed in the reply */
+   bool m_bReplyActive;
+   bool m_bReplySequence;
+   bool m_bReplySent;
+   uint8_t m_unReplySequence;
+   uint8_t m_unReplyType;
+   uint8_t m_unReplyOptions;
+
+   /* service time measurement */
+   uint32_t (*m_pfClock)();
+   uint32_t m_unRxDwell;
+   uint32_t m_unReplyStartTime;
+
+   /* packet that is matched by the receive interrupt and its frame in the current framing */
+   uint8_t m_unEmergencyType;
+   uint8_t m_unEmergencyDataLength;
+   uint8_t m_punEmergencyData[EMERGENCY_DATA_LENGTH];
+   void (*m_pfEmergencyHandler)();
+   uint8_t m_punEmergencyFrame[EMERGENCY_FRAME_LENGTH];
+
+   /* aggregated replies of a BATCH packet */
+   bool m_bBatchActive;
+   /* reply that EndBatch could not queue, with the sequence id of its request */
+   bool m_bBatchPending;
+   bool m_bBatchSequence;
+   uint8_t m_unBatchSequence;
+   uint8_t m_unBatchLength;
+   uint8_t m_punBatchBuffer[TX_COMMAND_BUFFER_LENGTH - NON_DATA_SIZE - SEQUENCE_FIELD_SIZE];
+
+   /* periodic telemetry, a period of zero marks an unused entry */
+   struct SSubscription {
+      uint8_t Type;
+      uint8_t Period;
+      uint8_t Countdown;
+      bool Due;
+   } m_psSubscriptions[SUBSCRIPTION_TABLE_LENGTH];
+
+   /* packets held until their execution time */
+   struct SScheduledPacket {
+      uint32_t Time;
+      uint8_t Type;
+      uint8_t Length;
+      uint8_t Data[SCHEDULE_DATA_LENGTH];
+      bool Pending;
+   } m_psScheduledPackets[SCHEDULE_QUEUE_LENGTH];
+
+   /* baud rate switch, the previous rate is restored unless the new rate is confirmed */
+   enum class EBaudRateSwitch : uint8_t {
+      IDLE,
+      PENDING,
+      UNCONFIRMED,
+   } m_eBaudRateSwitch;
+   uint32_t m_unBaudRate;
+   uint32_t m_unNextBaudRate;
+   uint32_t m_unFallbackBaudRate;
+   uint32_t m_unBaudRateSwitchTime;
+   uint16_t m_unBaudRateSwitchFrames;
+
+   SStatistics m_sStatistics;
+
+   /* fragmented packets */
+   uint8_t m_unTxMessageId;
+   /* the pending packet keeps the sequence id of the reply it belongs to */
+   bool m_bTxMessagePending;
+   bool m_bTxMessageSequence;
+   uint8_t m_unTxMessageSequence;
+   uint8_t m_unTxMessageType;
+   uint8_t m_unTxMessageIndex;
+   uint8_t m_unTxMessageOffset;
+   uint8_t m_unTxMessageLength;
+   uint8_t m_unTxMessageChunkLength;
+   uint8_t m_punTxMessageBuffer[TX_MESSAGE_BUFFER_LENGTH];
+   uint8_t m_unReassemblyId;
+   uint8_t m_unReassemblyType;
+   /* index of the next expected fragment, 0 if no packet is being reassembled */
+   uint8_t m_unReassemblyIndex;
+   uint8_t m_unReassemblyLength;
+   uint8_t m_punReassemblyBuffer[REASSEMBLY_BUFFER_LENGTH];
    
    CPacket m_cPacket;
 
    CHUARTController& m_cController;
 };
    
+/* the slots of the dispatch index, one entry per type id */
+template<class T, const CPacketControlInterface::SHandler<T>* PS_TABLE, uint8_t UN_TABLE_LENGTH>
+template<uint16_t... UN_TYPES>
+const uint8_t CPacketControlInterface::SDispatchIndex<T, PS_TABLE, UN_TABLE_LENGTH>::
+   SMap<CPacketControlInterface::SSequence<UN_TYPES...> >::Slots[sizeof...(UN_TYPES)] PROGMEM = {
+   FindSlot(UN_TYPES, 0)...
+};
+
 #endif
    
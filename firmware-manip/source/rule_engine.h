@@ -0,0 +1,198 @@
+#ifndef RULE_ENGINE_H
+#define RULE_ENGINE_H
+
+#include <stdint.h>
+#include <packet_control_interface.h>
+
+/* Runs small programs uploaded by the host with SET_RULE each time the telemetry
+   is refreshed, so that simple reactions do not need a round trip to the host.
+   A program is bytecode for a stack machine with signed 16 bit values, which
+   reads the control table and executes packets. The number of instructions of
+   a run is limited by the budget of the rule */
+#define RULE_ENGINE_NUM_SLOTS 2
+/* the bytecode of a rule fits into a SET_RULE packet of [slot][budget][bytecode] */
+#define RULE_PROGRAM_LENGTH 23
+#define RULE_STACK_DEPTH 6
+
+class CRuleEngine {
+public:
+   /* operands follow the opcode, jump offsets are signed and relative to the
+      next instruction. Binary operations pop b, then a and push (a op b) */
+   enum class EOpcode : uint8_t {
+      END = 0x00,
+      /* [value] pushes a signed byte */
+      PUSH8 = 0x01,
+      /* [value, 2 bytes] pushes a word */
+      PUSH16 = 0x02,
+      /* [address] pushes an unsigned byte of the control table */
+      LOAD8 = 0x03,
+      /* [address] pushes a signed word of the control table */
+      LOAD16 = 0x04,
+      DUP = 0x05,
+      DROP = 0x06,
+      ADD = 0x10,
+      SUB = 0x11,
+      ABS = 0x12,
+      NEG = 0x13,
+      LT = 0x18,
+      GT = 0x19,
+      EQ = 0x1A,
+      AND = 0x20,
+      OR = 0x21,
+      NOT = 0x22,
+      /* pops a condition, pushes 1 if it is true and was false in the previous
+         run. Each of the first eight EDGE instructions of a run keeps its own state */
+      EDGE = 0x28,
+      /* [offset] pops a value and jumps if it is zero */
+      JZ = 0x30,
+      /* [offset] */
+      JMP = 0x31,
+      /* [type][length][data] executes a packet, replies are sent unsolicited. Only
+         actuator packets and WRITE_RANGE are accepted, see IsExecutable */
+      EXEC = 0x40,
+   };
+
+   enum class EStatus : uint8_t {
+      EMPTY = 0,
+      /* the last run reached the end of the program */
+      READY = 1,
+      /* the last run was stopped by the budget, the next run starts over */
+      BUDGET_EXCEEDED = 2,
+      /* the stack overflowed or underflowed, the rule is stopped */
+      FAULT = 3,
+      /* the uploaded bytecode was rejected */
+      INVALID = 4,
+   };
+
+public:
+   CRuleEngine();
+
+   /* validates and loads the bytecode of a rule, an empty program or a zero budget
+      clears the slot. Returns false if the slot or the bytecode is invalid */
+   bool Load(uint8_t un_slot,
+             uint8_t un_budget,
+             const uint8_t* pun_program,
+             uint8_t un_length);
+
+   /* [status][budget][length][executed packets, 2 bytes] */
+   void GetStatus(uint8_t un_slot, uint8_t* pun_data) const;
+
+   /* runs each loaded rule once */
+   template<class T>
+   void Step(T& c_target,
+             const CPacketControlInterface::SField<T>* ps_table,
+             uint8_t un_table_length,
+             void (T::*pf_exec_packet)(const CPacketControlInterface::CPacket& c_packet)) {
+      for(uint8_t unSlot = 0; unSlot < RULE_ENGINE_NUM_SLOTS; unSlot++) {
+         SRule& sRule = m_psRules[unSlot];
+         if(sRule.Status != EStatus::READY && sRule.Status != EStatus::BUDGET_EXCEEDED) {
+            continue;
+         }
+         SMachine sMachine;
+         sMachine.Depth = 0;
+         sMachine.Edge = 0;
+         uint8_t unPc = 0;
+         uint8_t unBudget = sRule.Budget;
+         sRule.Status = EStatus::READY;
+         while(unPc < sRule.Length) {
+            if(unBudget == 0) {
+               sRule.Status = EStatus::BUDGET_EXCEEDED;
+               break;
+            }
+            unBudget--;
+            EOpcode eOpcode = static_cast<EOpcode>(sRule.Program[unPc]);
+            const uint8_t* punOperands = &sRule.Program[unPc + 1];
+            /* the bytecode was validated when it was loaded */
+            unPc += GetInstructionSize(&sRule.Program[unPc], sRule.Length - unPc);
+            bool bValid = true;
+            switch(eOpcode) {
+            case EOpcode::END:
+               unPc = sRule.Length;
+               break;
+            case EOpcode::LOAD8:
+            case EOpcode::LOAD16:
+               {
+                  uint8_t punValue[2];
+                  CPacketControlInterface::ReadRange(c_target,
+                                                     ps_table,
+                                                     un_table_length,
+                                                     punOperands[0],
+                                                     punValue,
+                                                     (eOpcode == EOpcode::LOAD8) ? 1 : 2);
+                  bValid = Push(sMachine, (eOpcode == EOpcode::LOAD8) ?
+                     int16_t(punValue[0]) : int16_t((punValue[0] << 8) | punValue[1]));
+               }
+               break;
+            case EOpcode::JZ:
+               {
+                  int16_t nValue;
+                  bValid = Pop(sMachine, nValue);
+                  if(bValid && nValue == 0) {
+                     unPc += reinterpret_cast<const int8_t&>(punOperands[0]);
+                  }
+               }
+               break;
+            case EOpcode::JMP:
+               unPc += reinterpret_cast<const int8_t&>(punOperands[0]);
+               break;
+            case EOpcode::EXEC:
+               {
+                  CPacketControlInterface::CPacket cPacket(punOperands[0],
+                                                           punOperands[1],
+                                                           &punOperands[2]);
+                  (c_target.*pf_exec_packet)(cPacket);
+                  sRule.Executions++;
+               }
+               break;
+            default:
+               bValid = Evaluate(sRule, sMachine, eOpcode, punOperands);
+               break;
+            }
+            if(!bValid) {
+               sRule.Status = EStatus::FAULT;
+               break;
+            }
+         }
+      }
+   }
+
+private:
+
+   struct SRule {
+      uint8_t Program[RULE_PROGRAM_LENGTH];
+      uint8_t Length;
+      uint8_t Budget;
+      EStatus Status;
+      /* state of the EDGE instructions, bit n belongs to the nth EDGE of a run */
+      uint8_t EdgeState;
+      uint16_t Executions;
+   };
+
+   struct SMachine {
+      int16_t Stack[RULE_STACK_DEPTH];
+      uint8_t Depth;
+      /* number of EDGE instructions executed in this run */
+      uint8_t Edge;
+   };
+
+   /* true for the packet types that a rule may execute */
+   static bool IsExecutable(uint8_t un_type);
+
+   /* returns the size of the instruction including its operands or zero if the
+      opcode is unknown or the operands are truncated */
+   static uint8_t GetInstructionSize(const uint8_t* pun_instruction, uint8_t un_remaining);
+
+   /* executes the instructions that only operate on the stack */
+   static bool Evaluate(SRule& s_rule,
+                        SMachine& s_machine,
+                        EOpcode e_opcode,
+                        const uint8_t* pun_operands);
+
+   static bool Push(SMachine& s_machine, int16_t n_value);
+
+   static bool Pop(SMachine& s_machine, int16_t& n_value);
+
+   SRule m_psRules[RULE_ENGINE_NUM_SLOTS];
+};
+
+#endif
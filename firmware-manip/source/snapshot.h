@@ -0,0 +1,39 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/* Double buffered copy of a telemetry structure. The producer fills the
+   back buffer and publishes it with Swap(), readers copy the front buffer.
+   Get() copies with interrupts disabled so that a producer running in an
+   interrupt can not swap the buffers in the middle of the copy. */
+template<typename T>
+class CSnapshot {
+public:
+   CSnapshot() :
+      m_unFront(0) {}
+
+   T& GetBackBuffer() {
+      return m_psBuffers[m_unFront ^ 1];
+   }
+
+   void Swap() {
+      /* single byte write, atomic */
+      m_unFront ^= 1;
+   }
+
+   T Get() const {
+      uint8_t unSREG = SREG;
+      cli();
+      T sCopy = m_psBuffers[m_unFront];
+      SREG = unSREG;
+      return sCopy;
+   }
+
+private:
+   T m_psBuffers[2];
+   volatile uint8_t m_unFront;
+};
+
+#endif
@@ -20,6 +20,9 @@ public:
    uint32_t GetMicroseconds();
    void Delay(uint32_t ms);
 
+   /* lowest byte of the overflow count, for timestamps taken in interrupts */
+   const volatile uint8_t* GetOverflowCounter() const;
+
 private:
    volatile uint8_t& m_unControlRegisterA;
    volatile uint8_t& m_unControlRegisterB;
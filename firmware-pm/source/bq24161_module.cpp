@@ -64,10 +64,12 @@ void CBQ24161Module::DumpRegister(uint8_t un_addr) {
    CFirmware::GetInstance().GetTWController().Write(un_addr);
    CFirmware::GetInstance().GetTWController().EndTransmission(false);
    CFirmware::GetInstance().GetTWController().Read(BQ24161_ADDR, 1, true);
-   fprintf(CFirmware::GetInstance().m_psHUART,
-           "Register 0x%02x : 0x%02x\r\n",
-           un_addr,
-           CFirmware::GetInstance().GetTWController().Read());
+   uint8_t punArgs[] = {
+      BQ24161_ADDR,
+      un_addr,
+      CFirmware::GetInstance().GetTWController().Read()
+   };
+   CFirmware::GetInstance().Log(CFirmware::ELogFormat::PMIC_REGISTER, punArgs, sizeof(punArgs));
 }
 
 /***********************************************************/
@@ -25,22 +25,6 @@ CFirmware CFirmware::_firmware;
 /* main function that runs the firmware */
 int main(void)
 {
-   /* FILE structs for fprintf */
-   FILE huart;
-
-   /* Set up FILE structs for fprintf */                           
-   fdev_setup_stream(&huart, 
-                     [](char c_to_write, FILE* pf_stream) {
-                        CFirmware::GetInstance().GetHUARTController().Write(c_to_write);
-                        return 1;
-                     },
-                     [](FILE* pf_stream) {
-                        return int(CFirmware::GetInstance().GetHUARTController().Read());
-                     },
-                     _FDEV_SETUP_RW);
-
-   CFirmware::GetInstance().SetFilePointer(&huart);
-
    /* Execute the firmware */
    CFirmware::GetInstance().Exec();
    /* Terminate */
@@ -136,8 +120,19 @@ void CFirmware::Exec()
    uint32_t unSwitchPressedTime = 0;
    bool bSyncRequiredSignal = false;
 
+   /* Measure the service time with the system timer */
+   m_cPacketControlInterface.SetClock([] {
+      return CFirmware::GetInstance().GetTimer().GetMicroseconds();
+   });
+   /* timer 2 overflows every 256 ticks of 64 clock cycles */
+   m_cHUARTController.SetRxTimebase(m_cTimer.GetOverflowCounter(),
+                                    256,
+                                    64 / (F_CPU / 1000000UL));
+
    m_cPowerManagementSystem.Init();
    m_cPowerEventInterrupt.Enable();
+   m_cPowerManagementSystem.LogStatus();
+   UpdateTelemetry();
 
    for(;;) {
       /* Respond to interrupt signals */
@@ -168,7 +163,15 @@ void CFirmware::Exec()
          bSyncRequiredSignal = false;
          /* Run the update loop for the power mangement system */
          m_cPowerManagementSystem.Update();
+         /* Publish the synchronised state for the replies */
+         UpdateTelemetry();
+         /* React to the synchronised state */
+         StepRules();
+         /* Step the subscriptions, so that they report the updated state */
+         m_cPacketControlInterface.StepSubscriptions();
       }
+      ExecScheduled();
+      ExecSubscriptions();
 
       /* Handle the switch state */
       if(m_eSwitchState == ESwitchState::PRESSED) {
@@ -202,111 +205,573 @@ void CFirmware::Exec()
       m_cPacketControlInterface.ProcessInput();
 
       if(m_cPacketControlInterface.GetState() == CPacketControlInterface::EState::RECV_COMMAND) {
-         CPacketControlInterface::CPacket cPacket = m_cPacketControlInterface.GetPacket();
-         switch(cPacket.GetType()) {
-         case CPacketControlInterface::CPacket::EType::GET_UPTIME:
-            if(cPacket.GetDataLength() == 0) {
-               uint32_t unUptime = m_cTimer.GetMilliseconds();
-               uint8_t punTxData[] = {
-                  uint8_t((unUptime >> 24) & 0xFF),
-                  uint8_t((unUptime >> 16) & 0xFF),
-                  uint8_t((unUptime >> 8 ) & 0xFF),
-                  uint8_t((unUptime >> 0 ) & 0xFF)
-               };
-               m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_UPTIME,
-                                                    punTxData,
-                                                    sizeof(punTxData));
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::GET_BATT_LVL:
-            if(cPacket.GetDataLength() == 0) {
-               uint8_t punTxData[] = {
-                  CADCController::GetInstance().GetValue(CADCController::EChannel::ADC6),
-                  CADCController::GetInstance().GetValue(CADCController::EChannel::ADC7)         
-               };
-               m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_BATT_LVL,
-                                                    punTxData,
-                                                    sizeof(punTxData));
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::GET_PM_STATUS:
-            if(cPacket.GetDataLength() == 0) {
-               uint8_t punTxData[] = {
-                  m_cPowerManagementSystem.IsSystemPowerOn(),
-                  m_cPowerManagementSystem.IsActuatorPowerOn(),
-                  m_cPowerManagementSystem.IsPassthroughPowerOn(),
-                  m_cPowerManagementSystem.IsSystemBatteryCharging(),
-                  m_cPowerManagementSystem.IsActuatorBatteryCharging(),
-                  static_cast<uint8_t>(m_cPowerManagementSystem.GetSystemInputLimit()),
-                  static_cast<uint8_t>(m_cPowerManagementSystem.GetActuatorInputLimit()),
-                  static_cast<uint8_t>(m_cPowerManagementSystem.GetAdapterInputState()),
-                  static_cast<uint8_t>(m_cPowerManagementSystem.GetUSBInputState()),
-               };
-               m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_PM_STATUS,
-                                                    punTxData,
-                                                    sizeof(punTxData));
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::GET_USB_STATUS:
-            if(cPacket.GetDataLength() == 0) {
-               uint8_t punTxData[] = {
-                  CUSBInterfaceSystem::GetInstance().IsEnabled(),
-                  CUSBInterfaceSystem::GetInstance().IsHighSpeedMode(),
-                  CUSBInterfaceSystem::GetInstance().IsSuspended(),
-                  static_cast<uint8_t>(CUSBInterfaceSystem::GetInstance().GetUSBChargerType()),
-               };
-               m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_USB_STATUS,
-                                                    punTxData,
-                                                    sizeof(punTxData));
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::SET_SYSTEM_POWER_ENABLE:
-            /* Set the enable signal for the actuator power supply */
-            if(cPacket.GetDataLength() == 1) {
-               const uint8_t* punRxData = cPacket.GetDataPointer();
-               m_cPowerManagementSystem.SetSystemPowerOn((punRxData[0] != 0) ? true : false);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::SET_ACTUATOR_POWER_ENABLE:
-            /* Set the enable signal for the actuator power supply */
-            if(cPacket.GetDataLength() == 1) {
-               const uint8_t* punRxData = cPacket.GetDataPointer();
-               m_cPowerManagementSystem.SetActuatorPowerOn((punRxData[0] != 0) ? true : false);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::SET_ACTUATOR_INPUT_LIMIT_OVERRIDE:
-            /* Set the speed of the differential drive system */
-            if(cPacket.GetDataLength() == 1) {
-               const uint8_t* punRxData = cPacket.GetDataPointer();
-               CBQ24250Module::EInputLimit e_input_limit = CBQ24250Module::EInputLimit::LHIZ;
-               switch (punRxData[0]) {
-               case 1:
-                  e_input_limit = CBQ24250Module::EInputLimit::L100;
-                  break;
-               case 2:
-                  e_input_limit = CBQ24250Module::EInputLimit::L150;
-                  break;
-               case 3:
-                  e_input_limit = CBQ24250Module::EInputLimit::L500;
-                  break;
-               case 4:
-                  e_input_limit = CBQ24250Module::EInputLimit::L900;
-                  break;
-               default:
-                  /* case 0 or invalid is LHIZ (no override / auto mode) */
-                  break;
-               }
-               m_cPowerManagementSystem.SetActuatorInputLimitOverride(e_input_limit);
-            }
-            break;
-         default:
-            /* unknown command */
-            break;
-         }
+         m_cPacketControlInterface.BeginReply();
+         ExecPacket(m_cPacketControlInterface.GetPacket());
+         m_cPacketControlInterface.EndReply();
+      }
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::UpdateTelemetry() {
+   /* Read the battery levels and the state of the PMICs into the back buffer and publish it */
+   STelemetry& sTelemetry = m_cTelemetry.GetBackBuffer();
+   sTelemetry.BattLvl[0] = CADCController::GetInstance().GetValue(CADCController::EChannel::ADC6);
+   sTelemetry.BattLvl[1] = CADCController::GetInstance().GetValue(CADCController::EChannel::ADC7);
+   sTelemetry.PMStatus[0] = m_cPowerManagementSystem.IsSystemPowerOn();
+   sTelemetry.PMStatus[1] = m_cPowerManagementSystem.IsActuatorPowerOn();
+   sTelemetry.PMStatus[2] = m_cPowerManagementSystem.IsPassthroughPowerOn();
+   sTelemetry.PMStatus[3] = m_cPowerManagementSystem.IsSystemBatteryCharging();
+   sTelemetry.PMStatus[4] = m_cPowerManagementSystem.IsActuatorBatteryCharging();
+   sTelemetry.PMStatus[5] = static_cast<uint8_t>(m_cPowerManagementSystem.GetSystemInputLimit());
+   sTelemetry.PMStatus[6] = static_cast<uint8_t>(m_cPowerManagementSystem.GetActuatorInputLimit());
+   sTelemetry.PMStatus[7] = static_cast<uint8_t>(m_cPowerManagementSystem.GetAdapterInputState());
+   sTelemetry.PMStatus[8] = static_cast<uint8_t>(m_cPowerManagementSystem.GetUSBInputState());
+   sTelemetry.Timestamp = m_cTimer.GetMicroseconds();
+   m_cTelemetry.Swap();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecBatch(const CPacketControlInterface::CPacket& c_packet) {
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   m_cPacketControlInterface.BeginBatch();
+   /* execute each [type][length][data] record in order */
+   for(uint8_t unOffset = 0; unOffset + 2 <= c_packet.GetDataLength();) {
+      CPacketControlInterface::CPacket cSubPacket(punRxData[unOffset],
+                                                  punRxData[unOffset + 1],
+                                                  &punRxData[unOffset + 2]);
+      unOffset += 2 + cSubPacket.GetDataLength();
+      /* drop truncated records and nested batches */
+      if(unOffset > c_packet.GetDataLength() ||
+         cSubPacket.GetType() == CPacketControlInterface::CPacket::EType::BATCH) {
+         break;
       }
+      ExecPacket(cSubPacket);
+   }
+   m_cPacketControlInterface.EndBatch();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSubscriptions() {
+   CPacketControlInterface::CPacket cPacket(0xFF, 0, nullptr);
+   while(m_cPacketControlInterface.GetDueSubscription(cPacket)) {
+      ExecPacket(cPacket);
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecScheduled() {
+   CPacketControlInterface::CPacket cPacket(0xFF, 0, nullptr);
+   while(m_cPacketControlInterface.GetDueScheduled(cPacket)) {
+      ExecPacket(cPacket);
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+/* packet dispatch table, the dispatch index that maps the types to their handlers
+   is built from it at compile time */
+constexpr CPacketControlInterface::SHandler<CFirmware> CFirmware::m_psPacketHandlers[] PROGMEM = {
+   /* type, minimum and maximum data length, handler */
+   {CPacketControlInterface::CPacket::EType::GET_UPTIME, 0, 0, &CFirmware::ExecGetUptime},
+   {CPacketControlInterface::CPacket::EType::GET_BATT_LVL, 0, 0, &CFirmware::ExecGetBattLvl},
+   {CPacketControlInterface::CPacket::EType::BATCH, 0, REASSEMBLY_BUFFER_LENGTH, &CFirmware::ExecBatch},
+   {CPacketControlInterface::CPacket::EType::SUBSCRIBE, 2, 2, &CFirmware::ExecSubscribe},
+   {CPacketControlInterface::CPacket::EType::UNSUBSCRIBE, 0, 1, &CFirmware::ExecUnsubscribe},
+   {CPacketControlInterface::CPacket::EType::SET_FRAMING, 1, 1, &CFirmware::ExecSetFraming},
+   {CPacketControlInterface::CPacket::EType::GET_LINK_STATS, 0, 0, &CFirmware::ExecGetLinkStats},
+   {CPacketControlInterface::CPacket::EType::READ_RANGE, 2, 2, &CFirmware::ExecReadRange},
+   {CPacketControlInterface::CPacket::EType::WRITE_RANGE, 1, 1 + CONTROL_TABLE_SIZE, &CFirmware::ExecWriteRange},
+   {CPacketControlInterface::CPacket::EType::GET_CAPABILITIES, 0, 0, &CFirmware::ExecGetCapabilities},
+   {CPacketControlInterface::CPacket::EType::SET_REPLY_OPTIONS, 1, 1, &CFirmware::ExecSetReplyOptions},
+   {CPacketControlInterface::CPacket::EType::SET_BAUD, 4, 4, &CFirmware::ExecSetBaud},
+   {CPacketControlInterface::CPacket::EType::SCHEDULE, 0, SCHEDULE_HEADER_SIZE + SCHEDULE_DATA_LENGTH, &CFirmware::ExecSchedule},
+   {CPacketControlInterface::CPacket::EType::SET_SYSTEM_POWER_ENABLE, 1, 1, &CFirmware::ExecSetSystemPowerEnable},
+   {CPacketControlInterface::CPacket::EType::SET_ACTUATOR_POWER_ENABLE, 1, 1, &CFirmware::ExecSetActuatorPowerEnable},
+   {CPacketControlInterface::CPacket::EType::SET_ACTUATOR_INPUT_LIMIT_OVERRIDE, 1, 1, &CFirmware::ExecSetActuatorInputLimitOverride},
+   {CPacketControlInterface::CPacket::EType::GET_PM_STATUS, 0, 0, &CFirmware::ExecGetPMStatus},
+   {CPacketControlInterface::CPacket::EType::GET_USB_STATUS, 0, 0, &CFirmware::ExecGetUSBStatus},
+   {CPacketControlInterface::CPacket::EType::SET_RULE, 2, 2 + RULE_PROGRAM_LENGTH, &CFirmware::ExecSetRule},
+   {CPacketControlInterface::CPacket::EType::GET_RULE_STATUS, 1, 1, &CFirmware::ExecGetRuleStatus}
+};
+
+static_assert(REASSEMBLY_BUFFER_LENGTH >= 1 + CONTROL_TABLE_SIZE &&
+              REASSEMBLY_BUFFER_LENGTH >= 2 + RULE_PROGRAM_LENGTH &&
+              REASSEMBLY_BUFFER_LENGTH >= SCHEDULE_HEADER_SIZE + SCHEDULE_DATA_LENGTH,
+              "a packet that is accepted does not fit into the reassembly buffer");
+
+/* control table fields, see CONTROL_TABLE_SIZE for the layout */
+const CPacketControlInterface::SField<CFirmware> CFirmware::m_psControlTable[] PROGMEM = {
+   /* address, size, read method, write method */
+   {0x00, 4, &CFirmware::ReadUptime, nullptr},
+   {0x04, 2, &CFirmware::ReadBattLvl, nullptr},
+   {0x06, 1, &CFirmware::ReadSystemPowerEnable, &CFirmware::WriteSystemPowerEnable},
+   {0x07, 1, &CFirmware::ReadActuatorPowerEnable, &CFirmware::WriteActuatorPowerEnable},
+   {0x08, 1, &CFirmware::ReadPassthroughPowerEnable, nullptr},
+   {0x09, 2, &CFirmware::ReadBatteryCharging, nullptr},
+   {0x0B, 2, &CFirmware::ReadInputLimit, nullptr},
+   {0x0D, 2, &CFirmware::ReadInputState, nullptr}
+};
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecPacket(const CPacketControlInterface::CPacket& c_packet) {
+   /* packets of unknown type or with an invalid length are ignored */
+   CPacketControlInterface::Dispatch<CFirmware,
+                                     m_psPacketHandlers,
+                                     sizeof(m_psPacketHandlers) / sizeof(m_psPacketHandlers[0])>(*this, c_packet);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSubscribe(const CPacketControlInterface::CPacket& c_packet) {
+   /* Periodically execute a request, a period of zero removes the subscription */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   CPacketControlInterface::CPacket::EType eType =
+      static_cast<CPacketControlInterface::CPacket::EType>(punRxData[0]);
+   if(punRxData[1] == 0) {
+      m_cPacketControlInterface.Unsubscribe(eType);
+   }
+   else {
+      m_cPacketControlInterface.Subscribe(eType, punRxData[1]);
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecUnsubscribe(const CPacketControlInterface::CPacket& c_packet) {
+   /* Remove a single subscription, or all subscriptions if no type is given */
+   if(c_packet.GetDataLength() == 1) {
+      const uint8_t* punRxData = c_packet.GetDataPointer();
+      m_cPacketControlInterface.Unsubscribe(
+         static_cast<CPacketControlInterface::CPacket::EType>(punRxData[0]));
+   }
+   else {
+      m_cPacketControlInterface.UnsubscribeAll();
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetFraming(const CPacketControlInterface::CPacket& c_packet) {
+   /* Switch between the legacy and the COBS framing, takes effect after the reply */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   switch(punRxData[0]) {
+   case 0:
+      m_cPacketControlInterface.SetFraming(CPacketControlInterface::EFraming::LEGACY);
+      break;
+   case 1:
+      m_cPacketControlInterface.SetFraming(CPacketControlInterface::EFraming::COBS);
+      break;
+   default:
+      break;
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetReplyOptions(const CPacketControlInterface::CPacket& c_packet) {
+   /* Bit 0 enables the sample timestamps, bit 1 the service time measurement */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   m_cPacketControlInterface.SetReplyOptions(punRxData[0]);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetBaud(const CPacketControlInterface::CPacket& c_packet) {
+   /* Switch the link to [baud rate] after the reply, the host confirms the new rate by
+      sending a valid frame at it, otherwise the previous rate is restored */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   uint32_t unBaudRate = (uint32_t(punRxData[0]) << 24) | (uint32_t(punRxData[1]) << 16) |
+                         (uint32_t(punRxData[2]) << 8 ) | (uint32_t(punRxData[3]) << 0 );
+   bool bAccepted = m_cPacketControlInterface.SetBaudRate(unBaudRate);
+   uint8_t punTxData[] = {
+      uint8_t(bAccepted ? 0x01 : 0x00),
+      punRxData[0],
+      punRxData[1],
+      punRxData[2],
+      punRxData[3]
+   };
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::SET_BAUD,
+                                        punTxData,
+                                        sizeof(punTxData));
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSchedule(const CPacketControlInterface::CPacket& c_packet) {
+   /* Hold [execution time][type][data] until the execution time, the reply carries the
+      current time so that the host can estimate the offset between the clocks */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   bool bAccepted = false;
+   if(c_packet.GetDataLength() == 0) {
+      m_cPacketControlInterface.CancelScheduled();
+      bAccepted = true;
+   }
+   else if(c_packet.GetDataLength() >= SCHEDULE_HEADER_SIZE) {
+      uint32_t unTime = (uint32_t(punRxData[0]) << 24) | (uint32_t(punRxData[1]) << 16) |
+                        (uint32_t(punRxData[2]) << 8 ) | (uint32_t(punRxData[3]) << 0 );
+      bAccepted = m_cPacketControlInterface.Schedule(unTime,
+                                                     punRxData[4],
+                                                     &punRxData[SCHEDULE_HEADER_SIZE],
+                                                     c_packet.GetDataLength() - SCHEDULE_HEADER_SIZE);
+   }
+   uint32_t unTime = m_cPacketControlInterface.GetTime();
+   uint8_t punTxData[] = {
+      uint8_t(bAccepted ? 0x01 : 0x00),
+      uint8_t((unTime >> 24) & 0xFF),
+      uint8_t((unTime >> 16) & 0xFF),
+      uint8_t((unTime >> 8 ) & 0xFF),
+      uint8_t((unTime >> 0 ) & 0xFF)
+   };
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::SCHEDULE,
+                                        punTxData,
+                                        sizeof(punTxData));
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetRule(const CPacketControlInterface::CPacket& c_packet) {
+   /* Load [slot][instruction budget][bytecode], rejected rules are reported by GET_RULE_STATUS */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   m_cRuleEngine.Load(punRxData[0], punRxData[1], &punRxData[2], c_packet.GetDataLength() - 2);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetRuleStatus(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t unSlot = c_packet.GetDataPointer()[0];
+   if(unSlot < RULE_ENGINE_NUM_SLOTS) {
+      uint8_t punTxData[5];
+      m_cRuleEngine.GetStatus(unSlot, punTxData);
+      m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_RULE_STATUS,
+                                           punTxData,
+                                           sizeof(punTxData));
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::StepRules() {
+   m_cRuleEngine.Step(*this,
+                      m_psControlTable,
+                      sizeof(m_psControlTable) / sizeof(m_psControlTable[0]),
+                      &CFirmware::ExecPacket);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetLinkStats(const CPacketControlInterface::CPacket& c_packet) {
+   const CPacketControlInterface::SStatistics& sInterfaceStatistics =
+      m_cPacketControlInterface.GetStatistics();
+   CHUARTController::SStatistics sHUARTStatistics = m_cHUARTController.GetStatistics();
+   uint16_t punCounters[] = {
+      sInterfaceStatistics.Frames,
+      sInterfaceStatistics.ChecksumErrors,
+      sInterfaceStatistics.Resyncs,
+      sInterfaceStatistics.DiscardedBytes,
+      sHUARTStatistics.RxDrops,
+      sHUARTStatistics.RxOverruns,
+      sHUARTStatistics.ParityErrors,
+      sHUARTStatistics.FrameErrors,
+      sHUARTStatistics.TxRejects,
+      sHUARTStatistics.TxDrops,
+   };
+   uint8_t punTxData[sizeof(punCounters)];
+   for(uint8_t unIdx = 0; unIdx < sizeof(punCounters) / sizeof(punCounters[0]); unIdx++) {
+      punTxData[2 * unIdx] = uint8_t((punCounters[unIdx] >> 8) & 0xFF);
+      punTxData[2 * unIdx + 1] = uint8_t((punCounters[unIdx] >> 0) & 0xFF);
+   }
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_LINK_STATS,
+                                        punTxData,
+                                        sizeof(punTxData));
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecReadRange(const CPacketControlInterface::CPacket& c_packet) {
+   /* Read [address][length] of the control table, the reply is [address][data] */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   uint8_t unAddress = punRxData[0];
+   uint8_t unLength = punRxData[1];
+   /* limit the range to the control table */
+   if(unAddress >= CONTROL_TABLE_SIZE) {
+      unLength = 0;
    }
+   else if(unLength > CONTROL_TABLE_SIZE - unAddress) {
+      unLength = CONTROL_TABLE_SIZE - unAddress;
+   }
+   uint8_t punTxData[1 + CONTROL_TABLE_SIZE];
+   punTxData[0] = unAddress;
+   CPacketControlInterface::ReadRange(*this,
+                                      m_psControlTable,
+                                      sizeof(m_psControlTable) / sizeof(m_psControlTable[0]),
+                                      unAddress,
+                                      &punTxData[1],
+                                      unLength);
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::READ_RANGE,
+                                        punTxData,
+                                        1 + unLength);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecWriteRange(const CPacketControlInterface::CPacket& c_packet) {
+   /* Write [address][data] to the control table */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   CPacketControlInterface::WriteRange(*this,
+                                       m_psControlTable,
+                                       sizeof(m_psControlTable) / sizeof(m_psControlTable[0]),
+                                       punRxData[0],
+                                       &punRxData[1],
+                                       c_packet.GetDataLength() - 1);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetCapabilities(const CPacketControlInterface::CPacket& c_packet) {
+   /* Describe the firmware so that the host does not need to probe it */
+   uint32_t unBaudRate = m_cPacketControlInterface.GetBaudRate();
+   uint16_t unBaudRates = m_cPacketControlInterface.GetSupportedBaudRates();
+   uint8_t punTxData[CAPABILITIES_HEADER_SIZE + SUPPORTED_TYPES_BITMAP_SIZE] = {
+      uint8_t((uint32_t(FIRMWARE_BUILD_ID) >> 24) & 0xFF),
+      uint8_t((uint32_t(FIRMWARE_BUILD_ID) >> 16) & 0xFF),
+      uint8_t((uint32_t(FIRMWARE_BUILD_ID) >> 8 ) & 0xFF),
+      uint8_t((uint32_t(FIRMWARE_BUILD_ID) >> 0 ) & 0xFF),
+      BOARD_TYPE,
+      GetId(),
+      RX_COMMAND_BUFFER_LENGTH,
+      TX_COMMAND_BUFFER_LENGTH,
+      HUART_RX_BUFFER_SIZE,
+      HUART_TX_BUFFER_SIZE,
+      REASSEMBLY_BUFFER_LENGTH,
+      CONTROL_TABLE_SIZE,
+      uint8_t((unBaudRate >> 24) & 0xFF),
+      uint8_t((unBaudRate >> 16) & 0xFF),
+      uint8_t((unBaudRate >> 8 ) & 0xFF),
+      uint8_t((unBaudRate >> 0 ) & 0xFF),
+      uint8_t((unBaudRates >> 8) & 0xFF),
+      uint8_t((unBaudRates >> 0) & 0xFF),
+   };
+   CPacketControlInterface::GetSupportedTypes(m_psPacketHandlers,
+                                              sizeof(m_psPacketHandlers) / sizeof(m_psPacketHandlers[0]),
+                                              &punTxData[CAPABILITIES_HEADER_SIZE]);
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_CAPABILITIES,
+                                        punTxData,
+                                        sizeof(punTxData));
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetUptime(const CPacketControlInterface::CPacket& c_packet) {
+   uint32_t unUptime = m_cTimer.GetMilliseconds();
+   uint8_t punTxData[] = {
+      uint8_t((unUptime >> 24) & 0xFF),
+      uint8_t((unUptime >> 16) & 0xFF),
+      uint8_t((unUptime >> 8 ) & 0xFF),
+      uint8_t((unUptime >> 0 ) & 0xFF)
+   };
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_UPTIME,
+                                        punTxData,
+                                        sizeof(punTxData));
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetBattLvl(const CPacketControlInterface::CPacket& c_packet) {
+   STelemetry sTelemetry = m_cTelemetry.Get();
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_BATT_LVL,
+                                        sTelemetry.BattLvl,
+                                        sizeof(sTelemetry.BattLvl),
+                                        sTelemetry.Timestamp);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetPMStatus(const CPacketControlInterface::CPacket& c_packet) {
+   STelemetry sTelemetry = m_cTelemetry.Get();
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_PM_STATUS,
+                                        sTelemetry.PMStatus,
+                                        sizeof(sTelemetry.PMStatus),
+                                        sTelemetry.Timestamp);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetUSBStatus(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t punTxData[] = {
+      CUSBInterfaceSystem::GetInstance().IsEnabled(),
+      CUSBInterfaceSystem::GetInstance().IsHighSpeedMode(),
+      CUSBInterfaceSystem::GetInstance().IsSuspended(),
+      static_cast<uint8_t>(CUSBInterfaceSystem::GetInstance().GetUSBChargerType()),
+   };
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_USB_STATUS,
+                                        punTxData,
+                                        sizeof(punTxData),
+                                        m_cTimer.GetMicroseconds());
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetSystemPowerEnable(const CPacketControlInterface::CPacket& c_packet) {
+   /* Set the enable signal for the actuator power supply */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   m_cPowerManagementSystem.SetSystemPowerOn((punRxData[0] != 0) ? true : false);
+   /* Request a sync so that the telemetry reflects the change */
+   m_bSystemPowerSignal = true;
 }
 
 /***********************************************************/
 /***********************************************************/
 
+void CFirmware::ExecSetActuatorPowerEnable(const CPacketControlInterface::CPacket& c_packet) {
+   /* Set the enable signal for the actuator power supply */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   m_cPowerManagementSystem.SetActuatorPowerOn((punRxData[0] != 0) ? true : false);
+   /* Request a sync so that the telemetry reflects the change */
+   m_bActuatorPowerSignal = true;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetActuatorInputLimitOverride(const CPacketControlInterface::CPacket& c_packet) {
+   /* Override the input current limit of the actuator power supply */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   CBQ24250Module::EInputLimit e_input_limit = CBQ24250Module::EInputLimit::LHIZ;
+   switch (punRxData[0]) {
+   case 1:
+      e_input_limit = CBQ24250Module::EInputLimit::L100;
+      break;
+   case 2:
+      e_input_limit = CBQ24250Module::EInputLimit::L150;
+      break;
+   case 3:
+      e_input_limit = CBQ24250Module::EInputLimit::L500;
+      break;
+   case 4:
+      e_input_limit = CBQ24250Module::EInputLimit::L900;
+      break;
+   default:
+      /* case 0 or invalid is LHIZ (no override / auto mode) */
+      break;
+   }
+   m_cPowerManagementSystem.SetActuatorInputLimitOverride(e_input_limit);
+   /* Request a sync so that the telemetry reflects the change */
+   m_bActuatorPowerSignal = true;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadUptime(uint8_t* pun_data) {
+   uint32_t unUptime = m_cTimer.GetMilliseconds();
+   pun_data[0] = uint8_t((unUptime >> 24) & 0xFF);
+   pun_data[1] = uint8_t((unUptime >> 16) & 0xFF);
+   pun_data[2] = uint8_t((unUptime >> 8 ) & 0xFF);
+   pun_data[3] = uint8_t((unUptime >> 0 ) & 0xFF);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadBattLvl(uint8_t* pun_data) {
+   STelemetry sTelemetry = m_cTelemetry.Get();
+   pun_data[0] = sTelemetry.BattLvl[0];
+   pun_data[1] = sTelemetry.BattLvl[1];
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadSystemPowerEnable(uint8_t* pun_data) {
+   pun_data[0] = m_cPowerManagementSystem.IsSystemPowerOn();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::WriteSystemPowerEnable(const uint8_t* pun_data) {
+   m_cPowerManagementSystem.SetSystemPowerOn(pun_data[0] != 0);
+   m_bSystemPowerSignal = true;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadActuatorPowerEnable(uint8_t* pun_data) {
+   pun_data[0] = m_cPowerManagementSystem.IsActuatorPowerOn();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::WriteActuatorPowerEnable(const uint8_t* pun_data) {
+   m_cPowerManagementSystem.SetActuatorPowerOn(pun_data[0] != 0);
+   m_bActuatorPowerSignal = true;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadPassthroughPowerEnable(uint8_t* pun_data) {
+   pun_data[0] = m_cPowerManagementSystem.IsPassthroughPowerOn();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadBatteryCharging(uint8_t* pun_data) {
+   STelemetry sTelemetry = m_cTelemetry.Get();
+   pun_data[0] = sTelemetry.PMStatus[3];
+   pun_data[1] = sTelemetry.PMStatus[4];
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadInputLimit(uint8_t* pun_data) {
+   STelemetry sTelemetry = m_cTelemetry.Get();
+   pun_data[0] = sTelemetry.PMStatus[5];
+   pun_data[1] = sTelemetry.PMStatus[6];
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadInputState(uint8_t* pun_data) {
+   STelemetry sTelemetry = m_cTelemetry.Get();
+   pun_data[0] = sTelemetry.PMStatus[7];
+   pun_data[1] = sTelemetry.PMStatus[8];
+}
+
+/***********************************************************/
+/***********************************************************/
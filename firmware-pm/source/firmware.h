@@ -21,6 +21,25 @@
 #include <huart_controller.h>
 #include <timer.h>
 #include <tw_controller.h>
+#include <snapshot.h>
+#include <rule_engine.h>
+
+/* reported by GET_CAPABILITIES, the build id is set by the Makefile */
+#define BOARD_TYPE 0x03
+#ifndef FIRMWARE_BUILD_ID
+#define FIRMWARE_BUILD_ID 0
+#endif
+
+/* control table of the power management board, all fields are big endian
+   0x00 uint32_t   uptime in milliseconds
+   0x04 uint8_t[2] battery level system, actuator
+   0x06 uint8_t    system power enable (read/write)
+   0x07 uint8_t    actuator power enable (read/write)
+   0x08 uint8_t    passthrough power enable
+   0x09 uint8_t[2] battery charging system, actuator
+   0x0B uint8_t[2] input limit system, actuator
+   0x0D uint8_t[2] input state adapter, USB */
+#define CONTROL_TABLE_SIZE 0x0F
 
 class CFirmware {
 public:
@@ -31,10 +50,6 @@ public:
 
    uint8_t GetId();
 
-   void SetFilePointer(FILE* ps_huart) {
-      m_psHUART = ps_huart;
-   }
-
 
    CHUARTController& GetHUARTController() {
       return m_cHUARTController;
@@ -48,12 +63,75 @@ public:
       return m_cTimer;
    }
 
+   /* Format ids of the LOG packets, the arguments are listed in brackets */
+   enum class ELogFormat : uint8_t {
+      PMIC_REGISTER        = 0x01, // [I2C address][register][value]
+      POWER_STATUS         = 0x02, // [system power][actuator power][system battery mV, 2 bytes][actuator battery mV, 2 bytes]
+      SYSTEM_PMIC_STATUS   = 0x03, // [state][fault][selected source][adapter input][USB input][battery state][input limit]
+      ACTUATOR_PMIC_STATUS = 0x04, // [state][fault][input limit][watchdog enabled][watchdog fault]
+   };
+
+   void Log(ELogFormat e_format,
+            const uint8_t* pun_args = nullptr,
+            uint8_t un_num_args = 0) {
+      m_cPacketControlInterface.Log(static_cast<uint8_t>(e_format), pun_args, un_num_args);
+   }
+
    void Exec();
 
    void TestPMICs();
       
 private:
 
+   /* Packet handlers */
+   void ExecPacket(const CPacketControlInterface::CPacket& c_packet);
+   void ExecBatch(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSubscriptions();
+   void ExecScheduled();
+   void ExecSubscribe(const CPacketControlInterface::CPacket& c_packet);
+   void ExecUnsubscribe(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetFraming(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetReplyOptions(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetBaud(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSchedule(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetLinkStats(const CPacketControlInterface::CPacket& c_packet);
+   void ExecReadRange(const CPacketControlInterface::CPacket& c_packet);
+   void ExecWriteRange(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetCapabilities(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetRule(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetRuleStatus(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetUptime(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetBattLvl(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetPMStatus(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetUSBStatus(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetSystemPowerEnable(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetActuatorPowerEnable(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetActuatorInputLimitOverride(const CPacketControlInterface::CPacket& c_packet);
+
+   /* Packet dispatch table */
+   static const CPacketControlInterface::SHandler<CFirmware> m_psPacketHandlers[];
+
+   /* Control table fields */
+   void ReadUptime(uint8_t* pun_data);
+   void ReadBattLvl(uint8_t* pun_data);
+   void ReadSystemPowerEnable(uint8_t* pun_data);
+   void WriteSystemPowerEnable(const uint8_t* pun_data);
+   void ReadActuatorPowerEnable(uint8_t* pun_data);
+   void WriteActuatorPowerEnable(const uint8_t* pun_data);
+   void ReadPassthroughPowerEnable(uint8_t* pun_data);
+   void ReadBatteryCharging(uint8_t* pun_data);
+   void ReadInputLimit(uint8_t* pun_data);
+   void ReadInputState(uint8_t* pun_data);
+
+   /* Control table */
+   static const CPacketControlInterface::SField<CFirmware> m_psControlTable[];
+
+   /* Refresh the telemetry snapshot */
+   void UpdateTelemetry();
+
+   /* Run the rules on the refreshed telemetry */
+   void StepRules();
+
    /* private constructor */
    CFirmware() :
       m_cTimer(TCCR2A,
@@ -94,6 +172,19 @@ private:
 
    CPowerManagementSystem m_cPowerManagementSystem;
 
+   /* Telemetry, refreshed after each sync with the PMICs and copied into replies */
+   struct STelemetry {
+      uint8_t BattLvl[2];
+      /* system, actuator and passthrough power, system and actuator battery
+         charging, system and actuator input limit, adapter and USB input state */
+      uint8_t PMStatus[9];
+      uint32_t Timestamp;
+   };
+   CSnapshot<STelemetry> m_cTelemetry;
+
+   /* Reactions uploaded by the host */
+   CRuleEngine m_cRuleEngine;
+
    class CPowerEventInterrupt : public CInterrupt {
    public:
       CPowerEventInterrupt(CFirmware* pc_firmware, 
@@ -124,11 +215,6 @@ private:
    bool m_bActuatorPowerSignal;
 
    static CFirmware _firmware;
-
-public: // TODO, don't make these public
-    /* File structs for fprintf */
-   FILE* m_psHUART;
-
 };
 
 #endif
@@ -24,17 +24,34 @@
 #define HUART_CONTROLLER_H
 
 #include <inttypes.h>
+#include <ring_buffer.h>
 
-#define SERIAL_BUFFER_SIZE 64
+/* sizes of the receive and transmit rings, powers of two of at most 128. The
+   receive ring holds at least one complete frame, the transmit ring queues
+   several complete frames */
+#define HUART_RX_BUFFER_SIZE 128
+#define HUART_TX_BUFFER_SIZE 64
+
+/* rate after reset, SET_BAUD switches to other rates at run time */
+#define HUART_BAUD_RATE 57600
+
+/* timer that the receive interrupt samples when a frame ends, the flag is set
+   from the end of a timer period until the interrupt of the timer has run */
+#define HUART_RX_TIMER_COUNT TCNT2
+#define HUART_RX_TIMER_PENDING (TIFR2 & _BV(TOV2))
 
 class CHUARTController // public CInputStream, public COutputStream { // BASIC! contains only ring buffer
 {
 public:
-   struct SRingBuffer
+   /* link statistics, the counters wrap around */
+   struct SStatistics
    {
-      uint8_t buffer[SERIAL_BUFFER_SIZE];
-      volatile unsigned int head;
-      volatile unsigned int tail;
+      uint16_t RxDrops;       // bytes dropped because the receive ring was full
+      uint16_t RxOverruns;    // bytes lost in the USART before they were read
+      uint16_t ParityErrors;
+      uint16_t FrameErrors;
+      uint16_t TxRejects;     // bytes refused by Write() and TrySend() because the transmit ring was full
+      uint16_t TxDrops;       // frames dropped by WriteFrame()
    };
 
    static CHUARTController& instance() {
@@ -43,16 +60,118 @@ public:
 
    void Begin(unsigned long);
    void End();
-   virtual int Available(void);
-   virtual int Peek(void);
-   virtual uint8_t Read(void);
-   virtual void Flush(void);
 
-   virtual uint8_t Write(uint8_t);
+   /* true if the USART generates the baud rate with an error below 2.5% */
+   bool IsBaudRateSupported(unsigned long baud);
+
+   /* true until the queued bytes have left the transmitter */
+   bool IsTransmitting();
+
+   int Available(void) {
+      return _rx_buffer->GetCount();
+   }
+
+   int Peek(void) {
+      return _rx_buffer->IsEmpty() ? -1 : _rx_buffer->Peek(0);
+   }
+
+   uint8_t Read(void) {
+      return _rx_buffer->IsEmpty() ? -1 : _rx_buffer->Pop();
+   }
+
+   void Flush(void);
+
+   /* zero-copy access to the receive ring buffer, the offset is
+      relative to the oldest unread byte and must be less than Available() */
+   uint8_t Peek(uint8_t un_offset) {
+      return _rx_buffer->Peek(un_offset);
+   }
+
+   /* returns nullptr if the range wraps around the end of the ring */
+   const uint8_t* GetRxPointer(uint8_t un_offset, uint8_t un_length) {
+      return _rx_buffer->GetPointer(un_offset, un_length);
+   }
+
+   /* returns the contiguous run of received bytes that starts at the offset,
+      un_length is limited to the length of the run */
+   const uint8_t* GetRxSpan(uint8_t un_offset, uint8_t& un_length) {
+      return _rx_buffer->GetSpan(un_offset, un_length);
+   }
+
+   /* copies received bytes without removing them from the ring */
+   void PeekBlock(uint8_t un_offset, uint8_t* pun_data, uint8_t un_length) {
+      _rx_buffer->Copy(un_offset, pun_data, un_length);
+   }
+
+   void Discard(uint8_t un_count) {
+      _rx_buffer->Discard(un_count);
+   }
+
+   /* removes up to un_length received bytes, returns the number of bytes read */
+   uint8_t ReadBlock(uint8_t* pun_data, uint8_t un_length) {
+      return _rx_buffer->PopBlock(pun_data, un_length);
+   }
+
+   /* queues a byte without blocking, returns 0 if the transmit ring is full */
+   uint8_t Write(uint8_t);
+
+   /* queues as many bytes as fit into the transmit ring without blocking,
+      returns the number of bytes queued */
+   uint8_t WriteBlock(const uint8_t* pun_data, uint8_t un_length);
+
+   /* like WriteBlock, but the bytes that did not fit are counted as rejected,
+      returns the number of bytes accepted */
+   uint8_t TrySend(const uint8_t* pun_data, uint8_t un_length);
+
+   /* zero-copy access to the transmit ring buffer, returns the contiguous free
+      run at the end of the queued bytes, un_length is limited to the length of
+      the run. CommitTx queues the bytes that have been written into it */
+   uint8_t* GetTxSpan(uint8_t& un_length) {
+      return _tx_buffer->GetFreeSpan(un_length);
+   }
+
+   void CommitTx(uint8_t un_count);
+
+   /* queues a frame of header, data and footer bytes for the transmit interrupt
+      without blocking. The frame is queued completely or, if the transmit ring
+      does not have enough space, not at all and false is returned */
+   bool WriteFrame(const uint8_t* pun_header, uint8_t un_header_length,
+                   const uint8_t* pun_data, uint8_t un_data_length,
+                   const uint8_t* pun_footer, uint8_t un_footer_length);
+
+   /* pf_handler is called as soon as the given frame has been received, the frame is
+      also passed on as usual. The frame must stay valid until the handler is replaced,
+      it is only matched from its first byte after a marker byte (see SetRxMarker) or
+      after the handler has been set. The handler runs in the receive interrupt, on
+      its path in C that the last byte of the frame takes, it must be short */
+   void SetEmergencyHandler(const uint8_t* pun_frame, uint8_t un_length, void (*pf_handler)());
+
+   /* the transmit complete interrupt calls pf_handler once all queued bytes
+      have left the transmitter, the interrupt is only enabled while a handler
+      is set so that the interrupt that refills the transmitter makes no calls */
+   void SetTxDrainedHandler(void (*pf_handler)());
+
+   /* the receive interrupt copies the timer and the low byte of a count of its
+      periods whenever the marker byte that ends a frame is received. GetRxMarkerAge
+      converts the copy into the microseconds since the last marker, which must be
+      less than 255 timer periods ago. The marker also anchors the emergency frame */
+   void SetRxTimebase(const volatile uint8_t* pun_periods,
+                      uint16_t un_period_ticks,
+                      uint8_t un_microseconds_per_tick);
+   void SetRxMarker(uint8_t un_marker);
+   uint32_t GetRxMarkerAge();
+
+   /* number of bytes that can be queued for transmission */
+   uint8_t FreeSpace() {
+      return _tx_buffer->GetFreeSpace();
+   }
+
+   SStatistics GetStatistics();
 
 private:
-   SRingBuffer *_rx_buffer;
-   SRingBuffer *_tx_buffer;
+   CRingBuffer<HUART_RX_BUFFER_SIZE> *_rx_buffer;
+   CRingBuffer<HUART_TX_BUFFER_SIZE> *_tx_buffer;
+   SStatistics *_statistics;
    volatile uint8_t *_ubrrh;
    volatile uint8_t *_ubrrl;
    volatile uint8_t *_ucsra;
@@ -66,6 +185,7 @@ private:
    uint8_t _u2x;
    bool transmitting;
 
+   void StartTransmitter();
 
 private:
    
@@ -588,266 +588,53 @@ CBQ24161Module::EInputState CPowerManagementSystem::GetUSBInputState() {
 /***********************************************************/
 /***********************************************************/
 
-/*
-void CPowerManagementSystem::PrintStatus() {
-   fprintf(CFirmware::GetInstance().m_psHUART, "<Power Domains>\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART, "system: %s\r\n",
-           IsSystemPowerOn()?"on":"off");
-   fprintf(CFirmware::GetInstance().m_psHUART, "actuators: %s\r\n",
-           IsActuatorPowerOn()?"on":"off");
-   fprintf(CFirmware::GetInstance().m_psHUART, "<Batteries>\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART, "Batt 1: %u\r\n",
-           CADCController::GetInstance().GetValue(CADCController::EChannel::ADC6) * ADC_BATT_MV_COEFF);
-   fprintf(CFirmware::GetInstance().m_psHUART, "Batt 2: %u\r\n",
-           CADCController::GetInstance().GetValue(CADCController::EChannel::ADC7) * ADC_BATT_MV_COEFF);
+void CPowerManagementSystem::LogStatus() {
+   uint16_t unSystemBatteryVoltage =
+      CADCController::GetInstance().GetValue(CADCController::EChannel::ADC6) * ADC_BATT_MV_COEFF;
+   uint16_t unActuatorBatteryVoltage =
+      CADCController::GetInstance().GetValue(CADCController::EChannel::ADC7) * ADC_BATT_MV_COEFF;
+   uint8_t punPowerStatus[] = {
+      IsSystemPowerOn(),
+      IsActuatorPowerOn(),
+      uint8_t((unSystemBatteryVoltage >> 8) & 0xFF),
+      uint8_t((unSystemBatteryVoltage >> 0) & 0xFF),
+      uint8_t((unActuatorBatteryVoltage >> 8) & 0xFF),
+      uint8_t((unActuatorBatteryVoltage >> 0) & 0xFF),
+   };
+   CFirmware::GetInstance().Log(CFirmware::ELogFormat::POWER_STATUS,
+                                punPowerStatus,
+                                sizeof(punPowerStatus));
 
    // System power manager
    m_cSystemPowerManager.Synchronize();
-   fprintf(CFirmware::GetInstance().m_psHUART, "<System PMIC>\r\n");
-   for(uint8_t i = 0; i < 7; i++) {
-      m_cSystemPowerManager.DumpRegister(i);
-   }
-   fprintf(CFirmware::GetInstance().m_psHUART, "---\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART, "state: ");
-   switch(m_cSystemPowerManager.GetDeviceState()) {
-   case CBQ24161Module::EDeviceState::STANDBY:
-      fprintf(CFirmware::GetInstance().m_psHUART, "STBY");
-      break;
-   case CBQ24161Module::EDeviceState::READY:
-      fprintf(CFirmware::GetInstance().m_psHUART, "RDY");
-      break;
-   case CBQ24161Module::EDeviceState::CHARGING:
-      fprintf(CFirmware::GetInstance().m_psHUART, "CHG");
-      break;
-   case CBQ24161Module::EDeviceState::DONE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "DONE");
-      break;
-   case CBQ24161Module::EDeviceState::FAULT:
-      fprintf(CFirmware::GetInstance().m_psHUART, "FAULT");
-      break;
-   }
-   fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART, "fault: ");
-   switch(m_cSystemPowerManager.GetFault()) {
-   case CBQ24161Module::EFault::NONE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "NA");
-      break;
-   case CBQ24161Module::EFault::DEV_THERMAL_SHDN:
-      fprintf(CFirmware::GetInstance().m_psHUART, "DTHM_SHDN");
-      break;
-   case CBQ24161Module::EFault::BATT_THERMAL_SHDN:
-      fprintf(CFirmware::GetInstance().m_psHUART, "BTHM_SHDN");
-      break;
-   case CBQ24161Module::EFault::WATCHDOG_TMR_EXPR:
-      fprintf(CFirmware::GetInstance().m_psHUART, "WTMR_EXP");
-      break;
-   case CBQ24161Module::EFault::SAFETY_TMR_EXPR:
-      fprintf(CFirmware::GetInstance().m_psHUART, "STMR_EXP");
-      break;
-   case CBQ24161Module::EFault::ADAPTER_FAULT:
-      fprintf(CFirmware::GetInstance().m_psHUART, "ADP");
-      break;
-   case CBQ24161Module::EFault::USB_FAULT:
-      fprintf(CFirmware::GetInstance().m_psHUART, "USB");
-      break;
-   case CBQ24161Module::EFault::BATT_FAULT:
-      fprintf(CFirmware::GetInstance().m_psHUART, "BATT");
-      break;
-   }
-   fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART, "selected source: ");
-   switch(m_cSystemPowerManager.GetSelectedSource()) {
-   case CBQ24161Module::ESource::NONE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "NA");
-      break;
-   case CBQ24161Module::ESource::ADAPTER:
-      fprintf(CFirmware::GetInstance().m_psHUART, "ADP");
-      break;
-   case CBQ24161Module::ESource::USB:
-      fprintf(CFirmware::GetInstance().m_psHUART, "USB");
-      break;
-   }
-   fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART, "ADP input: ");
-   switch(m_cSystemPowerManager.GetInputState(CBQ24161Module::ESource::ADAPTER)) {
-   case CBQ24161Module::EInputState::NORMAL:
-      fprintf(CFirmware::GetInstance().m_psHUART, "OK");
-      break;
-   case CBQ24161Module::EInputState::OVER_VOLTAGE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "OV");
-      break;
-   case CBQ24161Module::EInputState::WEAK_SOURCE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "WS");
-      break;
-   case CBQ24161Module::EInputState::UNDER_VOLTAGE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "UV");
-      break;
-   }
-   fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART, "USB input: ");
-   switch(m_cSystemPowerManager.GetInputState(CBQ24161Module::ESource::USB)) {
-   case CBQ24161Module::EInputState::NORMAL:
-      fprintf(CFirmware::GetInstance().m_psHUART, "OK");
-      break;
-   case CBQ24161Module::EInputState::OVER_VOLTAGE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "OV");
-      break;
-   case CBQ24161Module::EInputState::WEAK_SOURCE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "WS");
-      break;
-   case CBQ24161Module::EInputState::UNDER_VOLTAGE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "UV");
-      break;
-   }
-   fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART, "battery_state: ");
-   switch(m_cSystemPowerManager.GetBatteryState()) {
-   case CBQ24161Module::EBatteryState::NORMAL:
-      fprintf(CFirmware::GetInstance().m_psHUART, "OK");
-      break;
-   case CBQ24161Module::EBatteryState::OVER_VOLTAGE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "OV");
-      break;
-   case CBQ24161Module::EBatteryState::DISCONNECTED:
-      fprintf(CFirmware::GetInstance().m_psHUART, "DIS");
-      break;
-   case CBQ24161Module::EBatteryState::UNDEFINED:
-      fprintf(CFirmware::GetInstance().m_psHUART, "UNDEF");
-      break;
-   }
-   fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART, "input_limit: ");
-   switch(m_cSystemPowerManager.GetInputLimit(
-          m_cSystemPowerManager.GetSelectedSource())) {
-   case CBQ24161Module::EInputLimit::L0:
-      fprintf(CFirmware::GetInstance().m_psHUART, "0");
-      break;
-   case CBQ24161Module::EInputLimit::L100:
-      fprintf(CFirmware::GetInstance().m_psHUART, "100");
-      break;
-   case CBQ24161Module::EInputLimit::L150:
-      fprintf(CFirmware::GetInstance().m_psHUART, "150");
-      break;
-   case CBQ24161Module::EInputLimit::L500:
-      fprintf(CFirmware::GetInstance().m_psHUART, "500");
-      break;
-   case CBQ24161Module::EInputLimit::L800:
-      fprintf(CFirmware::GetInstance().m_psHUART, "800");
-      break;
-   case CBQ24161Module::EInputLimit::L900:
-      fprintf(CFirmware::GetInstance().m_psHUART, "900");
-      break;
-   case CBQ24161Module::EInputLimit::L1500:
-      fprintf(CFirmware::GetInstance().m_psHUART, "1500");
-      break;
-   case CBQ24161Module::EInputLimit::L2500:
-      fprintf(CFirmware::GetInstance().m_psHUART, "2500");
-      break;
-   }
-   fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
+   uint8_t punSystemPMICStatus[] = {
+      static_cast<uint8_t>(m_cSystemPowerManager.GetDeviceState()),
+      static_cast<uint8_t>(m_cSystemPowerManager.GetFault()),
+      static_cast<uint8_t>(m_cSystemPowerManager.GetSelectedSource()),
+      static_cast<uint8_t>(m_cSystemPowerManager.GetInputState(CBQ24161Module::ESource::ADAPTER)),
+      static_cast<uint8_t>(m_cSystemPowerManager.GetInputState(CBQ24161Module::ESource::USB)),
+      static_cast<uint8_t>(m_cSystemPowerManager.GetBatteryState()),
+      static_cast<uint8_t>(m_cSystemPowerManager.GetInputLimit(
+         m_cSystemPowerManager.GetSelectedSource())),
+   };
+   CFirmware::GetInstance().Log(CFirmware::ELogFormat::SYSTEM_PMIC_STATUS,
+                                punSystemPMICStatus,
+                                sizeof(punSystemPMICStatus));
 
    // Actuator power manager
    m_cActuatorPowerManager.Synchronize();
-   fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART, "<Actuator PMIC>\r\n");
-   for(uint8_t i = 0; i < 2; i++) {
-      m_cActuatorPowerManager.DumpRegister(i);
-   }
-   fprintf(CFirmware::GetInstance().m_psHUART, "---\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART, "state: ");
-   switch(m_cActuatorPowerManager.GetDeviceState()) {
-   case CBQ24250Module::EDeviceState::READY:
-      fprintf(CFirmware::GetInstance().m_psHUART, "RDY");
-      break;
-   case CBQ24250Module::EDeviceState::CHARGING:
-      fprintf(CFirmware::GetInstance().m_psHUART, "CHG");
-      break;
-   case CBQ24250Module::EDeviceState::DONE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "DONE");
-      break;
-   case CBQ24250Module::EDeviceState::FAULT:
-      fprintf(CFirmware::GetInstance().m_psHUART, "FAULT");
-      break;
-   }
-   fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART, "fault: ");
-   switch(m_cActuatorPowerManager.GetFault()) {
-   case CBQ24250Module::EFault::NONE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "NA");
-      break;
-   case CBQ24250Module::EFault::INPUT_OVER_VOLTAGE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "IN_OV");
-      break;
-   case CBQ24250Module::EFault::INPUT_UNDER_VOLTAGE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "IN_UV");
-      break;
-   case CBQ24250Module::EFault::SLEEP:
-      fprintf(CFirmware::GetInstance().m_psHUART, "SLP");
-      break;
-   case CBQ24250Module::EFault::BATT_THERMAL_SHDN:
-      fprintf(CFirmware::GetInstance().m_psHUART, "BTHM_SHDN");
-      break;
-   case CBQ24250Module::EFault::BATT_OVER_VOLTAGE:
-      fprintf(CFirmware::GetInstance().m_psHUART, "B_OV");
-      break;
-   case CBQ24250Module::EFault::DEV_THERMAL_SHDN:
-      fprintf(CFirmware::GetInstance().m_psHUART, "DTHM_SHDN");
-      break;
-   case CBQ24250Module::EFault::DEV_TIMER_FAULT:
-      fprintf(CFirmware::GetInstance().m_psHUART, "DTMR_FAIL");
-      break;
-   case CBQ24250Module::EFault::BATT_DISCONNECTED:
-      fprintf(CFirmware::GetInstance().m_psHUART, "NO_BATT");
-      break;
-   case CBQ24250Module::EFault::ISET_SHORTED:
-      fprintf(CFirmware::GetInstance().m_psHUART, "ISET_FAIL");
-      break;
-   case CBQ24250Module::EFault::INPUT_FAULT:
-      fprintf(CFirmware::GetInstance().m_psHUART, "IN_FAIL");
-      break;
-   case CBQ24250Module::EFault::UNDEFINED:
-      fprintf(CFirmware::GetInstance().m_psHUART, "UNDEF");
-      break;
-   }
-   fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART, "input_limit: ");
-   switch(m_cActuatorPowerManager.GetInputLimit()) {
-   case CBQ24250Module::EInputLimit::L100:
-      fprintf(CFirmware::GetInstance().m_psHUART, "100");
-      break;
-   case CBQ24250Module::EInputLimit::L150:
-      fprintf(CFirmware::GetInstance().m_psHUART, "150");
-      break;
-   case CBQ24250Module::EInputLimit::L500:
-      fprintf(CFirmware::GetInstance().m_psHUART, "500");
-      break;
-   case CBQ24250Module::EInputLimit::L900:
-      fprintf(CFirmware::GetInstance().m_psHUART, "900");
-      break;
-   case CBQ24250Module::EInputLimit::L1500:
-      fprintf(CFirmware::GetInstance().m_psHUART, "1500");
-      break;
-   case CBQ24250Module::EInputLimit::L2000:
-      fprintf(CFirmware::GetInstance().m_psHUART, "2000");
-      break;
-   case CBQ24250Module::EInputLimit::LEXT:
-      fprintf(CFirmware::GetInstance().m_psHUART, "EXT");
-      break;
-   case CBQ24250Module::EInputLimit::LPTM:
-      fprintf(CFirmware::GetInstance().m_psHUART, "PTM");
-      break;
-   case CBQ24250Module::EInputLimit::LHIZ:
-      fprintf(CFirmware::GetInstance().m_psHUART, "HIZ");
-      break;
-   }
-   fprintf(CFirmware::GetInstance().m_psHUART, "\r\n");
-   fprintf(CFirmware::GetInstance().m_psHUART,
-           "wd_en: %c\r\n",
-           m_cActuatorPowerManager.GetWatchdogEnabled()?'t':'f');
-   fprintf(CFirmware::GetInstance().m_psHUART,
-           "wd_fault: %c\r\n",
-           m_cActuatorPowerManager.GetWatchdogFault()?'t':'f');
+   uint8_t punActuatorPMICStatus[] = {
+      static_cast<uint8_t>(m_cActuatorPowerManager.GetDeviceState()),
+      static_cast<uint8_t>(m_cActuatorPowerManager.GetFault()),
+      static_cast<uint8_t>(m_cActuatorPowerManager.GetInputLimit()),
+      m_cActuatorPowerManager.GetWatchdogEnabled(),
+      m_cActuatorPowerManager.GetWatchdogFault(),
+   };
+   CFirmware::GetInstance().Log(CFirmware::ELogFormat::ACTUATOR_PMIC_STATUS,
+                                punActuatorPMICStatus,
+                                sizeof(punActuatorPMICStatus));
 }
 
-*/
+/***********************************************************/
+/***********************************************************/
 
@@ -42,6 +42,9 @@ public:
 
    void Update();
 
+   /* reports the state of the power domains and the PMICs as LOG packets */
+   void LogStatus();
+
 private:
    CBQ24161Module m_cSystemPowerManager;
    CBQ24250Module m_cActuatorPowerManager;
@@ -0,0 +1,181 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Ring buffer of bytes for a single producer and a single consumer, e.g. an
+   interrupt and the main loop. The producer only writes the head and the
+   consumer only writes the tail. Both indices are single bytes, so each side
+   reads the other's index atomically without disabling interrupts. N must be
+   a power of two so that the indices wrap with a mask, one entry is kept free
+   to tell a full ring from an empty one */
+template<uint8_t N>
+class CRingBuffer {
+   static_assert(N >= 2 && (N & (N - 1)) == 0, "the size of a ring buffer must be a power of two");
+
+public:
+   /* offsets of the indices from the start of a ring, for interrupts that
+      access it in assembly */
+   static constexpr uint8_t HEAD_OFFSET = N;
+   static constexpr uint8_t TAIL_OFFSET = N + 1;
+
+   CRingBuffer() :
+      m_unHead(0),
+      m_unTail(0) {
+      static_assert(offsetof(CRingBuffer, m_unHead) == HEAD_OFFSET &&
+                    offsetof(CRingBuffer, m_unTail) == TAIL_OFFSET,
+                    "the indices must follow the data");
+   }
+
+   uint8_t GetCount() const {
+      return (m_unHead - m_unTail) & (N - 1);
+   }
+
+   uint8_t GetFreeSpace() const {
+      return (m_unTail - m_unHead - 1) & (N - 1);
+   }
+
+   bool IsEmpty() const {
+      return (m_unHead == m_unTail);
+   }
+
+   /* producer, returns false if the ring is full */
+   bool Push(uint8_t un_value) {
+      uint8_t unHead = m_unHead;
+      uint8_t unNext = (unHead + 1) & (N - 1);
+      if(unNext == m_unTail) {
+         return false;
+      }
+      m_punBuffer[unHead] = un_value;
+      m_unHead = unNext;
+      return true;
+   }
+
+   /* consumer, returns false if the ring is empty. Each index is only loaded
+      once, which keeps the transmit interrupt short */
+   bool Pop(uint8_t& un_value) {
+      uint8_t unTail = m_unTail;
+      if(unTail == m_unHead) {
+         return false;
+      }
+      un_value = m_punBuffer[unTail];
+      m_unTail = (unTail + 1) & (N - 1);
+      return true;
+   }
+
+   /* consumer, the ring must not be empty */
+   uint8_t Pop() {
+      uint8_t unTail = m_unTail;
+      uint8_t unValue = m_punBuffer[unTail];
+      m_unTail = (unTail + 1) & (N - 1);
+      return unValue;
+   }
+
+   /* consumer, the offset is relative to the oldest byte and must be less than GetCount() */
+   uint8_t Peek(uint8_t un_offset) const {
+      return m_punBuffer[(m_unTail + un_offset) & (N - 1)];
+   }
+
+   /* consumer, returns nullptr if the range wraps around the end of the ring */
+   const uint8_t* GetPointer(uint8_t un_offset, uint8_t un_length) const {
+      uint8_t unIndex = (m_unTail + un_offset) & (N - 1);
+      if(unIndex + un_length > N) {
+         return nullptr;
+      }
+      /* the bytes before the head are not written by the producer anymore */
+      return const_cast<const uint8_t*>(&m_punBuffer[unIndex]);
+   }
+
+   /* consumer, returns the run of bytes that starts at the offset and ends at the
+      head or at the end of the ring, whichever comes first. The offset must not be
+      greater than GetCount(), un_length is limited to the length of the run */
+   const uint8_t* GetSpan(uint8_t un_offset, uint8_t& un_length) const {
+      uint8_t unIndex = (m_unTail + un_offset) & (N - 1);
+      uint8_t unCount = GetCount() - un_offset;
+      if(un_length > unCount) {
+         un_length = unCount;
+      }
+      if(un_length > N - unIndex) {
+         un_length = N - unIndex;
+      }
+      return const_cast<const uint8_t*>(&m_punBuffer[unIndex]);
+   }
+
+   /* consumer, copies bytes without removing them, the range must be less than GetCount() */
+   void Copy(uint8_t un_offset, uint8_t* pun_data, uint8_t un_length) const {
+      uint8_t unIndex = m_unTail + un_offset;
+      for(uint8_t unIdx = 0; unIdx < un_length; unIdx++) {
+         pun_data[unIdx] = m_punBuffer[unIndex++ & (N - 1)];
+      }
+   }
+
+   /* consumer, removes up to un_length bytes and returns the number of bytes removed */
+   uint8_t PopBlock(uint8_t* pun_data, uint8_t un_length) {
+      uint8_t unCount = GetCount();
+      if(un_length > unCount) {
+         un_length = unCount;
+      }
+      Copy(0, pun_data, un_length);
+      Discard(un_length);
+      return un_length;
+   }
+
+   /* producer, returns the free run of entries that starts at the head and ends
+      before the tail or at the end of the ring, whichever comes first. un_length
+      is limited to the length of the run, the bytes written into it are added
+      by Commit */
+   uint8_t* GetFreeSpan(uint8_t& un_length) {
+      uint8_t unHead = m_unHead;
+      uint8_t unFreeSpace = GetFreeSpace();
+      if(un_length > unFreeSpace) {
+         un_length = unFreeSpace;
+      }
+      if(un_length > N - unHead) {
+         un_length = N - unHead;
+      }
+      return const_cast<uint8_t*>(&m_punBuffer[unHead]);
+   }
+
+   /* producer, adds un_count bytes that have been written into the span of GetFreeSpan */
+   void Commit(uint8_t un_count) {
+      /* the bytes were written through a pointer that is not volatile, they must
+         be in place before the consumer sees the new head */
+      __asm__ __volatile__("" ::: "memory");
+      m_unHead = (m_unHead + un_count) & (N - 1);
+   }
+
+   /* producer, adds up to un_length bytes and returns the number of bytes added.
+      The head is only advanced once all bytes are in place */
+   uint8_t PushBlock(const uint8_t* pun_data, uint8_t un_length) {
+      uint8_t unFreeSpace = GetFreeSpace();
+      if(un_length > unFreeSpace) {
+         un_length = unFreeSpace;
+      }
+      uint8_t unIndex = m_unHead;
+      for(uint8_t unIdx = 0; unIdx < un_length; unIdx++) {
+         m_punBuffer[unIndex++ & (N - 1)] = pun_data[unIdx];
+      }
+      m_unHead = unIndex & (N - 1);
+      return un_length;
+   }
+
+   /* consumer */
+   void Discard(uint8_t un_count) {
+      m_unTail = (m_unTail + un_count) & (N - 1);
+   }
+
+   /* consumer */
+   void Clear() {
+      m_unTail = m_unHead;
+   }
+
+private:
+   /* volatile so that the compiler does not move accesses to the data across
+      the update of the indices */
+   volatile uint8_t m_punBuffer[N];
+   volatile uint8_t m_unHead;
+   volatile uint8_t m_unTail;
+};
+
+#endif
@@ -93,6 +93,14 @@ CTimer::CTimer(volatile uint8_t& un_ctrl_reg_a,
 /****************************************/
 /****************************************/
 
+const volatile uint8_t* CTimer::GetOverflowCounter() const {
+   /* the lowest byte comes first on the AVR */
+   return reinterpret_cast<const volatile uint8_t*>(&m_unOverflowCount);
+}
+
+/****************************************/
+/****************************************/
+
 uint32_t CTimer::GetMilliseconds() {
    uint32_t m;
    uint8_t oldSREG = SREG;
@@ -0,0 +1,90 @@
+
+#include "delta_stream.h"
+
+/****************************************/
+/****************************************/
+
+CDeltaStream::CDeltaStream() :
+   m_unSamplesPerFrame(0),
+   m_unKeyframeInterval(0),
+   m_unNumChannels(0),
+   m_unSamplesSinceKeyframe(0),
+   m_bKeyframeRequired(true),
+   m_unFrameLength(0),
+   m_unFrameSamples(0) {}
+
+/****************************************/
+/****************************************/
+
+void CDeltaStream::Configure(uint8_t un_samples_per_frame,
+                             uint8_t un_keyframe_interval,
+                             uint8_t un_num_channels) {
+   /* the number of samples must fit into bits 6-0 of the header */
+   m_unSamplesPerFrame = (un_samples_per_frame < DELTA_STREAM_KEYFRAME_FLAG) ?
+      un_samples_per_frame : (DELTA_STREAM_KEYFRAME_FLAG - 1);
+   m_unKeyframeInterval = un_keyframe_interval;
+   m_unNumChannels = (un_num_channels < DELTA_STREAM_MAX_CHANNELS) ?
+      un_num_channels : DELTA_STREAM_MAX_CHANNELS;
+   /* discard the current frame and restart with a keyframe */
+   m_unFrameSamples = 0;
+   m_bKeyframeRequired = true;
+}
+
+/****************************************/
+/****************************************/
+
+bool CDeltaStream::AddSample(uint8_t un_index, const int16_t* pn_sample) {
+   bool bKeyframe = false;
+   if(m_unFrameSamples == 0) {
+      /* start a new frame */
+      bKeyframe = m_bKeyframeRequired || (m_unSamplesSinceKeyframe >= m_unKeyframeInterval);
+      m_punFrame[0] = un_index;
+      m_punFrame[1] = bKeyframe ? DELTA_STREAM_KEYFRAME_FLAG : 0x00;
+      m_unFrameLength = DELTA_STREAM_HEADER_SIZE;
+      if(bKeyframe) {
+         m_bKeyframeRequired = false;
+         m_unSamplesSinceKeyframe = 0;
+      }
+   }
+   for(uint8_t unChannel = 0; unChannel < m_unNumChannels; unChannel++) {
+      if(bKeyframe) {
+         WriteAbsolute(pn_sample[unChannel]);
+      }
+      else {
+         /* int is 16 bits wide on the AVR, so the difference is taken in 32 bits */
+         int32_t nDelta = int32_t(pn_sample[unChannel]) - m_pnLastSample[unChannel];
+         if(nDelta >= -127 && nDelta <= 127) {
+            m_punFrame[m_unFrameLength++] = uint8_t(int8_t(nDelta));
+         }
+         else {
+            m_punFrame[m_unFrameLength++] = DELTA_STREAM_ESCAPE;
+            WriteAbsolute(pn_sample[unChannel]);
+         }
+      }
+      m_pnLastSample[unChannel] = pn_sample[unChannel];
+   }
+   m_unFrameSamples++;
+   if(m_unSamplesSinceKeyframe < UINT8_MAX) {
+      m_unSamplesSinceKeyframe++;
+   }
+   /* complete the frame if it is full or if the next sample might not fit */
+   uint8_t unFrameSpace = sizeof(m_punFrame) - m_unFrameLength;
+   if(m_unFrameSamples >= m_unSamplesPerFrame ||
+      3 * m_unNumChannels > unFrameSpace) {
+      m_punFrame[1] |= m_unFrameSamples;
+      m_unFrameSamples = 0;
+      return true;
+   }
+   return false;
+}
+
+/****************************************/
+/****************************************/
+
+void CDeltaStream::WriteAbsolute(int16_t n_value) {
+   m_punFrame[m_unFrameLength++] = uint8_t((n_value >> 8) & 0xFF);
+   m_punFrame[m_unFrameLength++] = uint8_t((n_value >> 0) & 0xFF);
+}
+
+/****************************************/
+/****************************************/
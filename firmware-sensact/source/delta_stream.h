@@ -0,0 +1,64 @@
+#ifndef DELTA_STREAM_H
+#define DELTA_STREAM_H
+
+#include <stdint.h>
+#include <packet_control_interface.h>
+
+/* Packs consecutive samples of up to DELTA_STREAM_MAX_CHANNELS int16_t channels
+   into frames of [index of the first sample][bit 7 keyframe, bits 6-0 number
+   of samples][samples]. A keyframe starts with the absolute values of the first
+   sample, all other samples are encoded as one signed byte per channel holding
+   the difference to the previous sample. Differences outside of [-127, 127] are
+   escaped with 0x80 followed by the absolute value */
+#define DELTA_STREAM_MAX_CHANNELS 5
+#define DELTA_STREAM_HEADER_SIZE 2
+#define DELTA_STREAM_KEYFRAME_FLAG 0x80
+#define DELTA_STREAM_ESCAPE 0x80
+
+class CDeltaStream {
+public:
+   CDeltaStream();
+
+   /* zero samples per frame disables the stream. A keyframe is sent at the
+      first frame boundary after the given number of samples */
+   void Configure(uint8_t un_samples_per_frame,
+                  uint8_t un_keyframe_interval,
+                  uint8_t un_num_channels);
+
+   bool IsEnabled() const {
+      return (m_unSamplesPerFrame != 0);
+   }
+
+   uint8_t GetNumChannels() const {
+      return m_unNumChannels;
+   }
+
+   /* adds a sample, returns true if the frame is complete */
+   bool AddSample(uint8_t un_index, const int16_t* pn_sample);
+
+   const uint8_t* GetFrame() const {
+      return m_punFrame;
+   }
+
+   uint8_t GetFrameLength() const {
+      return m_unFrameLength;
+   }
+
+private:
+   void WriteAbsolute(int16_t n_value);
+
+   uint8_t m_unSamplesPerFrame;
+   uint8_t m_unKeyframeInterval;
+   uint8_t m_unNumChannels;
+
+   uint8_t m_unSamplesSinceKeyframe;
+   bool m_bKeyframeRequired;
+   int16_t m_pnLastSample[DELTA_STREAM_MAX_CHANNELS];
+
+   /* the frame is completed when the next sample might not fit */
+   uint8_t m_punFrame[TX_COMMAND_BUFFER_LENGTH - NON_DATA_SIZE];
+   uint8_t m_unFrameLength;
+   uint8_t m_unFrameSamples;
+};
+
+#endif
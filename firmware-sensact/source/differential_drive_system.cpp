@@ -29,7 +29,9 @@ CDifferentialDriveSystem::CDifferentialDriveSystem() :
    m_cShaftEncodersInterrupt(this, PCINT1_vect_num),
    m_cPIDControlStepInterrupt(this, TIMER1_COMPA_vect_num),
    m_nLeftSteps(0),
-   m_nRightSteps(0) {
+   m_nRightSteps(0),
+   m_unControlStepCount(0),
+   m_unVelocityControlStep(0) {
 
    /* Initialise pins in a disabled, coasting state */
    PORTB &= ~(DRV8833_EN);
@@ -60,12 +62,17 @@ CDifferentialDriveSystem::CDifferentialDriveSystem() :
 
    /* CTC Mode , with precaler set to 64, OCR1A = 2039 (61.275Hz update frequency) */
    TCCR1B |= (1 << WGM12) | (1 << CS11) | (1 << CS10);
-   OCR1A = 2039;
+   OCR1A = CONTROL_STEP_PERIOD_TICKS - 1;
    
    /* Enable port change interrupts for right encoder A/B
       and left encoder A/B respectively */
    PCMSK1 |= (1 << PCINT8)  | (1 << PCINT9) |
              (1 << PCINT10) | (1 << PCINT11);
+
+   /* The compare interrupt counts the control steps, which are the timebase of
+      the firmware. It stays enabled, the PID controller only runs while the
+      system is enabled */
+   TIMSK1 |= (1 << OCIE1A);
 }
 
 /****************************************/
@@ -85,6 +92,27 @@ void CDifferentialDriveSystem::SetPIDParams(float f_Kp, float f_Ki, float f_Kd)
 /****************************************/
 /****************************************/
 
+void CDifferentialDriveSystem::GetTargetVelocity(int16_t& n_left_velocity, int16_t& n_right_velocity) {
+   m_cPIDControlStepInterrupt.GetTargetVelocity(n_left_velocity, n_right_velocity);
+}
+
+/****************************************/
+/****************************************/
+
+void CDifferentialDriveSystem::GetPIDParams(float& f_Kp, float& f_Ki, float& f_Kd) {
+   m_cPIDControlStepInterrupt.GetPIDParams(f_Kp, f_Ki, f_Kd);
+}
+
+/****************************************/
+/****************************************/
+
+bool CDifferentialDriveSystem::IsEnabled() {
+   return (PORTB & DRV8833_EN) != 0;
+}
+
+/****************************************/
+/****************************************/
+
 int16_t CDifferentialDriveSystem::GetLeftVelocity() {
    int16_t nVelocity;
    uint8_t unSREG = SREG;
@@ -109,25 +137,112 @@ int16_t CDifferentialDriveSystem::GetRightVelocity() {
 /****************************************/
 /****************************************/
 
+uint8_t CDifferentialDriveSystem::GetControlStepCount() {
+   /* the lowest byte of the count is read atomically */
+   return uint8_t(m_unControlStepCount);
+}
+
+/****************************************/
+/****************************************/
+
+const volatile uint8_t* CDifferentialDriveSystem::GetControlStepCounter() const {
+   /* the lowest byte comes first on the AVR */
+   return reinterpret_cast<const volatile uint8_t*>(&m_unControlStepCount);
+}
+
+/****************************************/
+/****************************************/
+
+void CDifferentialDriveSystem::GetTimebase(uint32_t& un_control_steps, uint16_t& un_ticks) {
+   uint8_t unSREG = SREG;
+   cli();
+   un_control_steps = m_unControlStepCount;
+   un_ticks = TCNT1;
+   /* a compare match is pending until the interrupt runs, which is never longer
+      than interrupts are disabled. The counter is read again after the flag, so
+      the ticks always belong to the step that follows the match */
+   if(TIFR1 & (1 << OCF1A)) {
+      un_control_steps++;
+      un_ticks = TCNT1;
+      /* the counter is cleared one tick after the flag is set */
+      if(un_ticks == CONTROL_STEP_PERIOD_TICKS - 1) {
+         un_ticks = 0;
+      }
+   }
+   SREG = unSREG;
+}
+
+/****************************************/
+/****************************************/
+
+uint32_t CDifferentialDriveSystem::GetMilliseconds() {
+   uint32_t unControlSteps;
+   uint16_t unTicks;
+   GetTimebase(unControlSteps, unTicks);
+   /* split the product so that it only overflows together with the result */
+   return (unControlSteps / 1000) * (CONTROL_STEP_PERIOD_TICKS * MICROSECONDS_PER_TICK) +
+      ((unControlSteps % 1000) * (CONTROL_STEP_PERIOD_TICKS * MICROSECONDS_PER_TICK) +
+       unTicks * MICROSECONDS_PER_TICK) / 1000;
+}
+
+/****************************************/
+/****************************************/
+
+uint32_t CDifferentialDriveSystem::GetMicroseconds() {
+   uint32_t unControlSteps;
+   uint16_t unTicks;
+   GetTimebase(unControlSteps, unTicks);
+   return (unControlSteps * CONTROL_STEP_PERIOD_TICKS + unTicks) * MICROSECONDS_PER_TICK;
+}
+
+/****************************************/
+/****************************************/
+
+void CDifferentialDriveSystem::GetVelocity(int16_t& n_left_velocity,
+                                           int16_t& n_right_velocity,
+                                           uint32_t& un_timestamp) {
+   uint8_t unSREG = SREG;
+   cli();
+   n_left_velocity = m_nLeftStepsOut;
+   n_right_velocity = m_nRightStepsOut;
+   un_timestamp = m_unVelocityControlStep * CONTROL_STEP_PERIOD_TICKS * MICROSECONDS_PER_TICK;
+   SREG = unSREG;
+}
+
+/****************************************/
+/****************************************/
+
 void CDifferentialDriveSystem::Enable() {
+   /* the emergency stop disables the system from an interrupt, so the
+      read-modify-writes of the interrupt masks and the port must not be interrupted */
+   uint8_t unSREG = SREG;
+   cli();
    /* Enable the shaft encoder interrupt */
    m_cShaftEncodersInterrupt.Enable();
    /* Enable the PID controller interrupt */
    m_cPIDControlStepInterrupt.Enable();
    /* Enable the motor driver */
    PORTB |= (DRV8833_EN);
+   /* restore SREG, re-enable interrupts if disabled */
+   SREG = unSREG;
 }
 
 /****************************************/
 /****************************************/
 
 void CDifferentialDriveSystem::Disable() {
+   /* since this method can be called from both an interrupt and non-interrupt
+      context, we must clear the interrupt flag */
+   uint8_t unSREG = SREG;
+   cli();
    /* Disable the motor driver */
    PORTB &= ~(DRV8833_EN);
    /* Disable the PID controller interrupt */
    m_cPIDControlStepInterrupt.Disable();
    /* Disable the shaft encoder interrupt */
    m_cShaftEncodersInterrupt.Disable();
+   /* restore SREG, re-enable interrupts if disabled */
+   SREG = unSREG;
 }
 
 /****************************************/
@@ -321,6 +436,7 @@ CDifferentialDriveSystem::CPIDControlStepInterrupt::CPIDControlStepInterrupt(
    m_nRightErrorIntegral(0.0f),
    m_fLeftOutput(0),
    m_fRightOutput(0),
+   m_bEnabled(false),
 
    /* most stable one, but not powerful enough */
    //m_fKp(0.25f),
@@ -353,16 +469,16 @@ void CDifferentialDriveSystem::CPIDControlStepInterrupt::Enable() {
    m_nRightErrorIntegral = 0;
    m_nLeftTarget = 0;
    m_nRightTarget = 0;
-   /* enable interrupt */
-   TIMSK1 |= (1 << OCIE1A);
+   /* run the controller in the following control steps */
+   m_bEnabled = true;
 }
 
 /****************************************/
 /****************************************/
 
 void CDifferentialDriveSystem::CPIDControlStepInterrupt::Disable() {
-   /* disable interrupt */
-   TIMSK1 &= ~(1 << OCIE1A);
+   /* the interrupt keeps counting the control steps */
+   m_bEnabled = false;
 }
 
 /****************************************/
@@ -391,7 +507,35 @@ void CDifferentialDriveSystem::CPIDControlStepInterrupt::SetTargetVelocity(int16
 /****************************************/
 /****************************************/
 
+void CDifferentialDriveSystem::CPIDControlStepInterrupt::GetPIDParams(float& f_Kp, float& f_Ki, float& f_Kd) {
+   uint8_t unSREG = SREG;
+   cli();
+   f_Kp = m_fKp;
+   f_Ki = m_fKi;
+   f_Kd = m_fKd;
+   SREG = unSREG;
+}
+
+/****************************************/
+/****************************************/
+
+void CDifferentialDriveSystem::CPIDControlStepInterrupt::GetTargetVelocity(int16_t& n_left_velocity, int16_t& n_right_velocity) {
+   uint8_t unSREG = SREG;
+   cli();
+   n_left_velocity = m_nLeftTarget;
+   n_right_velocity = m_nRightTarget;
+   SREG = unSREG;
+}
+
+/****************************************/
+/****************************************/
+
 void CDifferentialDriveSystem::CPIDControlStepInterrupt::ServiceRoutine() {
+   /* signal the completion of the control step */
+   m_pcDifferentialDriveSystem->m_unControlStepCount++;
+   if(!m_bEnabled) {
+      return;
+   }
    /* Calculate left PID intermediates */
    int16_t nLeftError = m_nLeftTarget - m_pcDifferentialDriveSystem->m_nLeftSteps;
    /* Accumulate the integral component */
@@ -451,6 +595,7 @@ void CDifferentialDriveSystem::CPIDControlStepInterrupt::ServiceRoutine() {
    /* copy the step counters for velocity measurements */
    m_pcDifferentialDriveSystem->m_nRightStepsOut = m_pcDifferentialDriveSystem->m_nRightSteps;
    m_pcDifferentialDriveSystem->m_nLeftStepsOut = m_pcDifferentialDriveSystem->m_nLeftSteps; 
+   m_pcDifferentialDriveSystem->m_unVelocityControlStep = m_pcDifferentialDriveSystem->m_unControlStepCount;
    /* clear the step counters */
    m_pcDifferentialDriveSystem->m_nRightSteps = 0;
    m_pcDifferentialDriveSystem->m_nLeftSteps = 0;
@@ -4,6 +4,10 @@
 #include <stdint.h>
 #include <interrupt.h>
 
+/* Timer 1 - 8us per tick at a prescaler of 64 */
+#define CONTROL_STEP_PERIOD_TICKS 2040UL
+#define MICROSECONDS_PER_TICK 8UL
+
 class CDifferentialDriveSystem {
 public:
    CDifferentialDriveSystem();
@@ -14,6 +18,26 @@ public:
    int16_t GetLeftVelocity();
    int16_t GetRightVelocity();
 
+   void GetTargetVelocity(int16_t& n_left_velocity, int16_t& n_right_velocity);
+   void GetPIDParams(float& f_Kp, float& f_Ki, float& f_Kd);
+
+   bool IsEnabled();
+
+   /* number of control steps (61.275Hz), wraps around */
+   uint8_t GetControlStepCount();
+
+   /* lowest byte of the control step count, for timestamps taken in interrupts */
+   const volatile uint8_t* GetControlStepCounter() const;
+
+   /* time since start up, derived from timer 1 which clocks the control steps */
+   uint32_t GetMilliseconds();
+   uint32_t GetMicroseconds();
+
+   /* velocities of the last control step in which they were measured and the time in
+      microseconds at which that step ended. The velocities are not updated while the
+      system is disabled */
+   void GetVelocity(int16_t& n_left_velocity, int16_t& n_right_velocity, uint32_t& un_timestamp);
+
    void Enable();
    void Disable();
 
@@ -54,6 +78,8 @@ public:
       void Disable();
       void SetTargetVelocity(int16_t n_left_velocity, int16_t n_right_velocity);
       void SetPIDParams(float f_Kp, float f_Ki, float f_Kd);
+      void GetTargetVelocity(int16_t& n_left_velocity, int16_t& n_right_velocity);
+      void GetPIDParams(float& f_Kp, float& f_Ki, float& f_Kd);
    private:
       void ServiceRoutine();
    private:   
@@ -67,6 +93,7 @@ public:
       int32_t m_nRightErrorIntegral;
       float m_fLeftOutput;
       float m_fRightOutput;
+      bool m_bEnabled;
       float m_fKp;
       float m_fKi;
       float m_fKd;     
@@ -81,6 +108,12 @@ public:
    /* Cached step count variable */
    volatile int16_t m_nLeftStepsOut;
    volatile int16_t m_nRightStepsOut;
+   /* Control step counter */
+   volatile uint32_t m_unControlStepCount;
+   /* Control step in which the cached step counts were taken */
+   volatile uint32_t m_unVelocityControlStep;
+
+   void GetTimebase(uint32_t& un_control_steps, uint16_t& un_ticks);
 };
 
 #endif
@@ -7,22 +7,6 @@ CFirmware CFirmware::_firmware;
 /* main function that runs the firmware */
 int main(void)
 {
-   /* FILE structs for fprintf */
-   FILE huart;
-
-   /* Set up FILE structs for fprintf */                           
-   fdev_setup_stream(&huart, 
-                     [](char c_to_write, FILE* pf_stream) {
-                        CFirmware::GetInstance().GetHUARTController().Write(c_to_write);
-                        return 1;
-                     },
-                     [](FILE* pf_stream) {
-                        return int(CFirmware::GetInstance().GetHUARTController().Read());
-                     },
-                     _FDEV_SETUP_RW);
-
-   CFirmware::GetInstance().SetFilePointer(&huart);
-
    /* Execute the firmware */
    CFirmware::GetInstance().Exec();
 
@@ -34,113 +18,667 @@ int main(void)
 /***********************************************************/
 
 void CFirmware::Exec() {
+   /* Disable the differential drive system from an interrupt as soon as a SET_DDS_ENABLE(0)
+      packet without a sequence id is received, so that the stop does not wait for the main loop */
+   static const uint8_t punEmergencyStopData[] = {0x00};
+   m_cPacketControlInterface.SetEmergencyPacket(CPacketControlInterface::CPacket::EType::SET_DDS_ENABLE,
+                                                punEmergencyStopData,
+                                                sizeof(punEmergencyStopData),
+                                                [] {
+      CFirmware::GetInstance().m_cDifferentialDriveSystem.Disable();
+   });
+
+   /* Measure the service time with the timebase of the control steps */
+   m_cPacketControlInterface.SetClock([] {
+      return CFirmware::GetInstance().m_cDifferentialDriveSystem.GetMicroseconds();
+   });
+   m_cHUARTController.SetRxTimebase(m_cDifferentialDriveSystem.GetControlStepCounter(),
+                                    CONTROL_STEP_PERIOD_TICKS,
+                                    MICROSECONDS_PER_TICK);
+
    m_cAccelerometerSystem.Init();
 
+   uint8_t unControlStepCount = m_cDifferentialDriveSystem.GetControlStepCount();
+
    for(;;) {
+      /* Run the rules and step the subscriptions once per control step of the differential
+         drive system */
+      if(unControlStepCount != m_cDifferentialDriveSystem.GetControlStepCount()) {
+         StepRules();
+      }
+      while(unControlStepCount != m_cDifferentialDriveSystem.GetControlStepCount()) {
+         unControlStepCount++;
+         m_cPacketControlInterface.StepSubscriptions();
+         if(m_cDDSSpeedStream.IsEnabled()) {
+            StepDDSSpeedStream(unControlStepCount);
+         }
+      }
+      ExecScheduled();
+      ExecSubscriptions();
+
       m_cPacketControlInterface.ProcessInput();
 
       if(m_cPacketControlInterface.GetState() == CPacketControlInterface::EState::RECV_COMMAND) {
-         CPacketControlInterface::CPacket cPacket = m_cPacketControlInterface.GetPacket();
-         switch(cPacket.GetType()) {
-         case CPacketControlInterface::CPacket::EType::SET_DDS_ENABLE:
-            /* Set the enable signal for the differential drive system */
-            if(cPacket.GetDataLength() == 1) {
-               const uint8_t* punRxData = cPacket.GetDataPointer();
-               if(punRxData[0] == 0) {
-                  m_cDifferentialDriveSystem.Disable();
-               }
-               else {
-                  m_cDifferentialDriveSystem.Enable();
-               }
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::SET_DDS_PARAMS:
-            /* Set the parameters of the differential drive system */
-            if(cPacket.GetDataLength() == 12) {
-               const uint8_t* punRxData = cPacket.GetDataPointer();
-               float fKp, fKi, fKd;
-               uint32_t nData1, nData2, nData3, nData4, nData32;
-               nData1 = 0xFF & punRxData[0];
-               nData2 = 0xFF & punRxData[1];
-               nData3 = 0xFF & punRxData[2];
-               nData4 = 0xFF & punRxData[3];
-               nData32 = nData1<<24 | nData2<<16 | nData3<<8 | nData4;
-               fKp = *(reinterpret_cast<float*>(&nData32));
-               nData1 = 0xFF & punRxData[4];
-               nData2 = 0xFF & punRxData[5];
-               nData3 = 0xFF & punRxData[6];
-               nData4 = 0xFF & punRxData[7];
-               nData32 = nData1<<24 | nData2<<16 | nData3<<8 | nData4;
-               fKi = *(reinterpret_cast<float*>(&nData32));
-               nData1 = 0xFF & punRxData[8];
-               nData2 = 0xFF & punRxData[9];
-               nData3 = 0xFF & punRxData[10];
-               nData4 = 0xFF & punRxData[11];
-               nData32 = nData1<<24 | nData2<<16 | nData3<<8 | nData4;
-               fKd = *(reinterpret_cast<float*>(&nData32));
-               m_cDifferentialDriveSystem.SetPIDParams(fKp, fKi, fKd);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::SET_DDS_SPEED:
-            /* Set the speed of the differential drive system */
-            if(cPacket.GetDataLength() == 4) {
-               const uint8_t* punRxData = cPacket.GetDataPointer();
-               int16_t nLeftVelocity, nRightVelocity;
-               reinterpret_cast<uint16_t&>(nLeftVelocity) = (punRxData[0] << 8) | punRxData[1];
-               reinterpret_cast<uint16_t&>(nRightVelocity) = (punRxData[2] << 8) | punRxData[3];
-               m_cDifferentialDriveSystem.SetTargetVelocity(nLeftVelocity, nRightVelocity);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::GET_DDS_SPEED:
-            if(cPacket.GetDataLength() == 0) {
-               /* Get the speed of the differential drive system */               
-               int16_t nLeftSpeed = m_cDifferentialDriveSystem.GetLeftVelocity();
-               int16_t nRightSpeed = m_cDifferentialDriveSystem.GetRightVelocity();
-               uint8_t punTxData[] {
-                  reinterpret_cast<uint8_t*>(&nLeftSpeed)[1],
-                  reinterpret_cast<uint8_t*>(&nLeftSpeed)[0],
-                  reinterpret_cast<uint8_t*>(&nRightSpeed)[1],
-                  reinterpret_cast<uint8_t*>(&nRightSpeed)[0],
-               };
-               m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_DDS_SPEED,
-                                                    punTxData,
-                                                    sizeof(punTxData));
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::GET_UPTIME:
-            if(cPacket.GetDataLength() == 0) {
-               /* timer not implemented to improve interrupt latency for the shaft encoders */
-               uint8_t punTxData[] = {0, 0, 0, 0};
-               m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_UPTIME,
-                                                    punTxData,
-                                                    4);
-            }
-            break;
-         case CPacketControlInterface::CPacket::EType::GET_ACCEL_READING:
-            if(cPacket.GetDataLength() == 0) {
-               CAccelerometerSystem::SReading sReading = m_cAccelerometerSystem.GetReading();
-               uint8_t punTxData[] = {
-                  uint8_t((sReading.X >> 8) & 0xFF),
-                  uint8_t((sReading.X >> 0) & 0xFF),
-                  uint8_t((sReading.Y >> 8) & 0xFF),
-                  uint8_t((sReading.Y >> 0) & 0xFF),
-                  uint8_t((sReading.Z >> 8) & 0xFF),
-                  uint8_t((sReading.Z >> 0) & 0xFF),
-                  uint8_t((sReading.Temp >> 8) & 0xFF),
-                  uint8_t((sReading.Temp >> 0) & 0xFF),                  
-               };
-               m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_ACCEL_READING,
-                                                    punTxData,
-                                                    sizeof(punTxData));
-            }
-            break;
-         default:
-            /* unknown command */
-            break;
-         }
+         m_cPacketControlInterface.BeginReply();
+         ExecPacket(m_cPacketControlInterface.GetPacket());
+         m_cPacketControlInterface.EndReply();
       }
    }
 }
 
 /***********************************************************/
 /***********************************************************/
+
+void CFirmware::UpdateTelemetry() {
+   /* The accelerometer is read over I2C, which blocks the main loop, so the snapshot is only
+      refreshed when a reply, the speed stream or a rule uses it and at most once per control step */
+   uint8_t unControlStepCount = m_cDifferentialDriveSystem.GetControlStepCount();
+   if(m_bTelemetryValid && m_unTelemetryControlStep == unControlStepCount) {
+      return;
+   }
+   m_bTelemetryValid = true;
+   m_unTelemetryControlStep = unControlStepCount;
+   /* Read the sensors into the back buffer and publish it */
+   STelemetry& sTelemetry = m_cTelemetry.GetBackBuffer();
+   sTelemetry.AccelReading = m_cAccelerometerSystem.GetReading();
+   sTelemetry.AccelTimestamp = m_cDifferentialDriveSystem.GetMicroseconds();
+   m_cTelemetry.Swap();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::StepDDSSpeedStream(uint8_t un_control_step) {
+   /* the accelerometer channels are optional */
+   if(m_cDDSSpeedStream.GetNumChannels() > 2) {
+      UpdateTelemetry();
+   }
+   CAccelerometerSystem::SReading sReading = m_cTelemetry.Get().AccelReading;
+   int16_t pnSample[] = {
+      m_cDifferentialDriveSystem.GetLeftVelocity(),
+      m_cDifferentialDriveSystem.GetRightVelocity(),
+      sReading.X,
+      sReading.Y,
+      sReading.Z,
+   };
+   if(m_cDDSSpeedStream.AddSample(un_control_step, pnSample)) {
+      m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::DDS_SPEED_STREAM,
+                                           m_cDDSSpeedStream.GetFrame(),
+                                           m_cDDSSpeedStream.GetFrameLength());
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecBatch(const CPacketControlInterface::CPacket& c_packet) {
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   m_cPacketControlInterface.BeginBatch();
+   /* execute each [type][length][data] record in order */
+   for(uint8_t unOffset = 0; unOffset + 2 <= c_packet.GetDataLength();) {
+      CPacketControlInterface::CPacket cSubPacket(punRxData[unOffset],
+                                                  punRxData[unOffset + 1],
+                                                  &punRxData[unOffset + 2]);
+      unOffset += 2 + cSubPacket.GetDataLength();
+      /* drop truncated records and nested batches */
+      if(unOffset > c_packet.GetDataLength() ||
+         cSubPacket.GetType() == CPacketControlInterface::CPacket::EType::BATCH) {
+         break;
+      }
+      ExecPacket(cSubPacket);
+   }
+   m_cPacketControlInterface.EndBatch();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSubscriptions() {
+   CPacketControlInterface::CPacket cPacket(0xFF, 0, nullptr);
+   while(m_cPacketControlInterface.GetDueSubscription(cPacket)) {
+      ExecPacket(cPacket);
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecScheduled() {
+   CPacketControlInterface::CPacket cPacket(0xFF, 0, nullptr);
+   while(m_cPacketControlInterface.GetDueScheduled(cPacket)) {
+      ExecPacket(cPacket);
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+/* packet dispatch table, the dispatch index that maps the types to their handlers
+   is built from it at compile time */
+constexpr CPacketControlInterface::SHandler<CFirmware> CFirmware::m_psPacketHandlers[] PROGMEM = {
+   /* type, minimum and maximum data length, handler */
+   {CPacketControlInterface::CPacket::EType::GET_UPTIME, 0, 0, &CFirmware::ExecGetUptime},
+   {CPacketControlInterface::CPacket::EType::BATCH, 0, REASSEMBLY_BUFFER_LENGTH, &CFirmware::ExecBatch},
+   {CPacketControlInterface::CPacket::EType::SUBSCRIBE, 2, 2, &CFirmware::ExecSubscribe},
+   {CPacketControlInterface::CPacket::EType::UNSUBSCRIBE, 0, 1, &CFirmware::ExecUnsubscribe},
+   {CPacketControlInterface::CPacket::EType::SET_FRAMING, 1, 1, &CFirmware::ExecSetFraming},
+   {CPacketControlInterface::CPacket::EType::GET_LINK_STATS, 0, 0, &CFirmware::ExecGetLinkStats},
+   {CPacketControlInterface::CPacket::EType::READ_RANGE, 2, 2, &CFirmware::ExecReadRange},
+   {CPacketControlInterface::CPacket::EType::WRITE_RANGE, 1, 1 + CONTROL_TABLE_SIZE, &CFirmware::ExecWriteRange},
+   {CPacketControlInterface::CPacket::EType::GET_CAPABILITIES, 0, 0, &CFirmware::ExecGetCapabilities},
+   {CPacketControlInterface::CPacket::EType::SET_REPLY_OPTIONS, 1, 1, &CFirmware::ExecSetReplyOptions},
+   {CPacketControlInterface::CPacket::EType::SET_BAUD, 4, 4, &CFirmware::ExecSetBaud},
+   {CPacketControlInterface::CPacket::EType::SCHEDULE, 0, SCHEDULE_HEADER_SIZE + SCHEDULE_DATA_LENGTH, &CFirmware::ExecSchedule},
+   {CPacketControlInterface::CPacket::EType::SET_DDS_ENABLE, 1, 1, &CFirmware::ExecSetDDSEnable},
+   {CPacketControlInterface::CPacket::EType::SET_DDS_SPEED, 4, 4, &CFirmware::ExecSetDDSSpeed},
+   {CPacketControlInterface::CPacket::EType::GET_DDS_SPEED, 0, 0, &CFirmware::ExecGetDDSSpeed},
+   {CPacketControlInterface::CPacket::EType::SET_DDS_PARAMS, 12, 12, &CFirmware::ExecSetDDSParams},
+   {CPacketControlInterface::CPacket::EType::DDS_SPEED_STREAM, 2, 3, &CFirmware::ExecDDSSpeedStream},
+   {CPacketControlInterface::CPacket::EType::GET_ACCEL_READING, 0, 0, &CFirmware::ExecGetAccelReading},
+   {CPacketControlInterface::CPacket::EType::SET_RULE, 2, 2 + RULE_PROGRAM_LENGTH, &CFirmware::ExecSetRule},
+   {CPacketControlInterface::CPacket::EType::GET_RULE_STATUS, 1, 1, &CFirmware::ExecGetRuleStatus}
+};
+
+static_assert(REASSEMBLY_BUFFER_LENGTH >= 1 + CONTROL_TABLE_SIZE &&
+              REASSEMBLY_BUFFER_LENGTH >= 2 + RULE_PROGRAM_LENGTH &&
+              REASSEMBLY_BUFFER_LENGTH >= SCHEDULE_HEADER_SIZE + SCHEDULE_DATA_LENGTH,
+              "a packet that is accepted does not fit into the reassembly buffer");
+
+/* control table fields, see CONTROL_TABLE_SIZE for the layout */
+const CPacketControlInterface::SField<CFirmware> CFirmware::m_psControlTable[] PROGMEM = {
+   /* address, size, read method, write method */
+   {0x00, 4, &CFirmware::ReadTargetVelocity, &CFirmware::WriteTargetVelocity},
+   {0x04, 4, &CFirmware::ReadVelocity, nullptr},
+   {0x08, 12, &CFirmware::ReadPIDParams, &CFirmware::WritePIDParams},
+   {0x14, 8, &CFirmware::ReadAccelReading, nullptr},
+   {0x1C, 1, &CFirmware::ReadDDSEnable, &CFirmware::WriteDDSEnable}
+};
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecPacket(const CPacketControlInterface::CPacket& c_packet) {
+   /* packets of unknown type or with an invalid length are ignored */
+   CPacketControlInterface::Dispatch<CFirmware,
+                                     m_psPacketHandlers,
+                                     sizeof(m_psPacketHandlers) / sizeof(m_psPacketHandlers[0])>(*this, c_packet);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSubscribe(const CPacketControlInterface::CPacket& c_packet) {
+   /* Periodically execute a request, a period of zero removes the subscription */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   CPacketControlInterface::CPacket::EType eType =
+      static_cast<CPacketControlInterface::CPacket::EType>(punRxData[0]);
+   if(punRxData[1] == 0) {
+      m_cPacketControlInterface.Unsubscribe(eType);
+   }
+   else {
+      m_cPacketControlInterface.Subscribe(eType, punRxData[1]);
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecUnsubscribe(const CPacketControlInterface::CPacket& c_packet) {
+   /* Remove a single subscription, or all subscriptions if no type is given */
+   if(c_packet.GetDataLength() == 1) {
+      const uint8_t* punRxData = c_packet.GetDataPointer();
+      m_cPacketControlInterface.Unsubscribe(
+         static_cast<CPacketControlInterface::CPacket::EType>(punRxData[0]));
+   }
+   else {
+      m_cPacketControlInterface.UnsubscribeAll();
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetFraming(const CPacketControlInterface::CPacket& c_packet) {
+   /* Switch between the legacy and the COBS framing, takes effect after the reply */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   switch(punRxData[0]) {
+   case 0:
+      m_cPacketControlInterface.SetFraming(CPacketControlInterface::EFraming::LEGACY);
+      break;
+   case 1:
+      m_cPacketControlInterface.SetFraming(CPacketControlInterface::EFraming::COBS);
+      break;
+   default:
+      break;
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetReplyOptions(const CPacketControlInterface::CPacket& c_packet) {
+   /* Bit 0 enables the sample timestamps, bit 1 the service time measurement */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   m_cPacketControlInterface.SetReplyOptions(punRxData[0]);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetBaud(const CPacketControlInterface::CPacket& c_packet) {
+   /* Switch the link to [baud rate] after the reply, the host confirms the new rate by
+      sending a valid frame at it, otherwise the previous rate is restored */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   uint32_t unBaudRate = (uint32_t(punRxData[0]) << 24) | (uint32_t(punRxData[1]) << 16) |
+                         (uint32_t(punRxData[2]) << 8 ) | (uint32_t(punRxData[3]) << 0 );
+   bool bAccepted = m_cPacketControlInterface.SetBaudRate(unBaudRate);
+   uint8_t punTxData[] = {
+      uint8_t(bAccepted ? 0x01 : 0x00),
+      punRxData[0],
+      punRxData[1],
+      punRxData[2],
+      punRxData[3]
+   };
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::SET_BAUD,
+                                        punTxData,
+                                        sizeof(punTxData));
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSchedule(const CPacketControlInterface::CPacket& c_packet) {
+   /* Hold [execution time][type][data] until the execution time, the reply carries the
+      current time so that the host can estimate the offset between the clocks */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   bool bAccepted = false;
+   if(c_packet.GetDataLength() == 0) {
+      m_cPacketControlInterface.CancelScheduled();
+      bAccepted = true;
+   }
+   else if(c_packet.GetDataLength() >= SCHEDULE_HEADER_SIZE) {
+      uint32_t unTime = (uint32_t(punRxData[0]) << 24) | (uint32_t(punRxData[1]) << 16) |
+                        (uint32_t(punRxData[2]) << 8 ) | (uint32_t(punRxData[3]) << 0 );
+      bAccepted = m_cPacketControlInterface.Schedule(unTime,
+                                                     punRxData[4],
+                                                     &punRxData[SCHEDULE_HEADER_SIZE],
+                                                     c_packet.GetDataLength() - SCHEDULE_HEADER_SIZE);
+   }
+   uint32_t unTime = m_cPacketControlInterface.GetTime();
+   uint8_t punTxData[] = {
+      uint8_t(bAccepted ? 0x01 : 0x00),
+      uint8_t((unTime >> 24) & 0xFF),
+      uint8_t((unTime >> 16) & 0xFF),
+      uint8_t((unTime >> 8 ) & 0xFF),
+      uint8_t((unTime >> 0 ) & 0xFF)
+   };
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::SCHEDULE,
+                                        punTxData,
+                                        sizeof(punTxData));
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetRule(const CPacketControlInterface::CPacket& c_packet) {
+   /* Load [slot][instruction budget][bytecode], rejected rules are reported by GET_RULE_STATUS */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   m_cRuleEngine.Load(punRxData[0], punRxData[1], &punRxData[2], c_packet.GetDataLength() - 2);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetRuleStatus(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t unSlot = c_packet.GetDataPointer()[0];
+   if(unSlot < RULE_ENGINE_NUM_SLOTS) {
+      uint8_t punTxData[5];
+      m_cRuleEngine.GetStatus(unSlot, punTxData);
+      m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_RULE_STATUS,
+                                           punTxData,
+                                           sizeof(punTxData));
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::StepRules() {
+   m_cRuleEngine.Step(*this,
+                      m_psControlTable,
+                      sizeof(m_psControlTable) / sizeof(m_psControlTable[0]),
+                      &CFirmware::ExecPacket);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetLinkStats(const CPacketControlInterface::CPacket& c_packet) {
+   const CPacketControlInterface::SStatistics& sInterfaceStatistics =
+      m_cPacketControlInterface.GetStatistics();
+   CHUARTController::SStatistics sHUARTStatistics = m_cHUARTController.GetStatistics();
+   uint16_t punCounters[] = {
+      sInterfaceStatistics.Frames,
+      sInterfaceStatistics.ChecksumErrors,
+      sInterfaceStatistics.Resyncs,
+      sInterfaceStatistics.DiscardedBytes,
+      sHUARTStatistics.RxDrops,
+      sHUARTStatistics.RxOverruns,
+      sHUARTStatistics.ParityErrors,
+      sHUARTStatistics.FrameErrors,
+      sHUARTStatistics.TxRejects,
+      sHUARTStatistics.TxDrops,
+   };
+   uint8_t punTxData[sizeof(punCounters)];
+   for(uint8_t unIdx = 0; unIdx < sizeof(punCounters) / sizeof(punCounters[0]); unIdx++) {
+      punTxData[2 * unIdx] = uint8_t((punCounters[unIdx] >> 8) & 0xFF);
+      punTxData[2 * unIdx + 1] = uint8_t((punCounters[unIdx] >> 0) & 0xFF);
+   }
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_LINK_STATS,
+                                        punTxData,
+                                        sizeof(punTxData));
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecReadRange(const CPacketControlInterface::CPacket& c_packet) {
+   /* Read [address][length] of the control table, the reply is [address][data] */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   uint8_t unAddress = punRxData[0];
+   uint8_t unLength = punRxData[1];
+   /* limit the range to the control table */
+   if(unAddress >= CONTROL_TABLE_SIZE) {
+      unLength = 0;
+   }
+   else if(unLength > CONTROL_TABLE_SIZE - unAddress) {
+      unLength = CONTROL_TABLE_SIZE - unAddress;
+   }
+   uint8_t punTxData[1 + CONTROL_TABLE_SIZE];
+   punTxData[0] = unAddress;
+   CPacketControlInterface::ReadRange(*this,
+                                      m_psControlTable,
+                                      sizeof(m_psControlTable) / sizeof(m_psControlTable[0]),
+                                      unAddress,
+                                      &punTxData[1],
+                                      unLength);
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::READ_RANGE,
+                                        punTxData,
+                                        1 + unLength);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecWriteRange(const CPacketControlInterface::CPacket& c_packet) {
+   /* Write [address][data] to the control table */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   CPacketControlInterface::WriteRange(*this,
+                                       m_psControlTable,
+                                       sizeof(m_psControlTable) / sizeof(m_psControlTable[0]),
+                                       punRxData[0],
+                                       &punRxData[1],
+                                       c_packet.GetDataLength() - 1);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetCapabilities(const CPacketControlInterface::CPacket& c_packet) {
+   /* Describe the firmware so that the host does not need to probe it */
+   uint32_t unBaudRate = m_cPacketControlInterface.GetBaudRate();
+   uint16_t unBaudRates = m_cPacketControlInterface.GetSupportedBaudRates();
+   uint8_t punTxData[CAPABILITIES_HEADER_SIZE + SUPPORTED_TYPES_BITMAP_SIZE] = {
+      uint8_t((uint32_t(FIRMWARE_BUILD_ID) >> 24) & 0xFF),
+      uint8_t((uint32_t(FIRMWARE_BUILD_ID) >> 16) & 0xFF),
+      uint8_t((uint32_t(FIRMWARE_BUILD_ID) >> 8 ) & 0xFF),
+      uint8_t((uint32_t(FIRMWARE_BUILD_ID) >> 0 ) & 0xFF),
+      BOARD_TYPE,
+      RX_COMMAND_BUFFER_LENGTH,
+      TX_COMMAND_BUFFER_LENGTH,
+      HUART_RX_BUFFER_SIZE,
+      HUART_TX_BUFFER_SIZE,
+      REASSEMBLY_BUFFER_LENGTH,
+      CONTROL_TABLE_SIZE,
+      uint8_t((unBaudRate >> 24) & 0xFF),
+      uint8_t((unBaudRate >> 16) & 0xFF),
+      uint8_t((unBaudRate >> 8 ) & 0xFF),
+      uint8_t((unBaudRate >> 0 ) & 0xFF),
+      uint8_t((unBaudRates >> 8) & 0xFF),
+      uint8_t((unBaudRates >> 0) & 0xFF),
+   };
+   CPacketControlInterface::GetSupportedTypes(m_psPacketHandlers,
+                                              sizeof(m_psPacketHandlers) / sizeof(m_psPacketHandlers[0]),
+                                              &punTxData[CAPABILITIES_HEADER_SIZE]);
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_CAPABILITIES,
+                                        punTxData,
+                                        sizeof(punTxData));
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetDDSEnable(const CPacketControlInterface::CPacket& c_packet) {
+   /* Set the enable signal for the differential drive system */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   if(punRxData[0] == 0) {
+      m_cDifferentialDriveSystem.Disable();
+   }
+   else {
+      m_cDifferentialDriveSystem.Enable();
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetDDSParams(const CPacketControlInterface::CPacket& c_packet) {
+   /* Set the parameters of the differential drive system */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   float fKp, fKi, fKd;
+   uint32_t nData1, nData2, nData3, nData4, nData32;
+   nData1 = 0xFF & punRxData[0];
+   nData2 = 0xFF & punRxData[1];
+   nData3 = 0xFF & punRxData[2];
+   nData4 = 0xFF & punRxData[3];
+   nData32 = nData1<<24 | nData2<<16 | nData3<<8 | nData4;
+   fKp = *(reinterpret_cast<float*>(&nData32));
+   nData1 = 0xFF & punRxData[4];
+   nData2 = 0xFF & punRxData[5];
+   nData3 = 0xFF & punRxData[6];
+   nData4 = 0xFF & punRxData[7];
+   nData32 = nData1<<24 | nData2<<16 | nData3<<8 | nData4;
+   fKi = *(reinterpret_cast<float*>(&nData32));
+   nData1 = 0xFF & punRxData[8];
+   nData2 = 0xFF & punRxData[9];
+   nData3 = 0xFF & punRxData[10];
+   nData4 = 0xFF & punRxData[11];
+   nData32 = nData1<<24 | nData2<<16 | nData3<<8 | nData4;
+   fKd = *(reinterpret_cast<float*>(&nData32));
+   m_cDifferentialDriveSystem.SetPIDParams(fKp, fKi, fKd);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecSetDDSSpeed(const CPacketControlInterface::CPacket& c_packet) {
+   /* Set the speed of the differential drive system */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   int16_t nLeftVelocity, nRightVelocity;
+   reinterpret_cast<uint16_t&>(nLeftVelocity) = (punRxData[0] << 8) | punRxData[1];
+   reinterpret_cast<uint16_t&>(nRightVelocity) = (punRxData[2] << 8) | punRxData[3];
+   m_cDifferentialDriveSystem.SetTargetVelocity(nLeftVelocity, nRightVelocity);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetDDSSpeed(const CPacketControlInterface::CPacket& c_packet) {
+   /* Get the speed of the differential drive system */
+   int16_t nLeftSpeed, nRightSpeed;
+   uint32_t unTimestamp;
+   m_cDifferentialDriveSystem.GetVelocity(nLeftSpeed, nRightSpeed, unTimestamp);
+   uint8_t punTxData[] {
+      reinterpret_cast<uint8_t*>(&nLeftSpeed)[1],
+      reinterpret_cast<uint8_t*>(&nLeftSpeed)[0],
+      reinterpret_cast<uint8_t*>(&nRightSpeed)[1],
+      reinterpret_cast<uint8_t*>(&nRightSpeed)[0],
+   };
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_DDS_SPEED,
+                                        punTxData,
+                                        sizeof(punTxData),
+                                        unTimestamp);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetUptime(const CPacketControlInterface::CPacket& c_packet) {
+   /* derived from the timer of the control steps to avoid an extra interrupt */
+   uint32_t unUptime = m_cDifferentialDriveSystem.GetMilliseconds();
+   uint8_t punTxData[] = {
+      uint8_t((unUptime >> 24) & 0xFF),
+      uint8_t((unUptime >> 16) & 0xFF),
+      uint8_t((unUptime >> 8 ) & 0xFF),
+      uint8_t((unUptime >> 0 ) & 0xFF)
+   };
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_UPTIME,
+                                        punTxData,
+                                        4);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecGetAccelReading(const CPacketControlInterface::CPacket& c_packet) {
+   UpdateTelemetry();
+   STelemetry sTelemetry = m_cTelemetry.Get();
+   CAccelerometerSystem::SReading& sReading = sTelemetry.AccelReading;
+   uint8_t punTxData[] = {
+      uint8_t((sReading.X >> 8) & 0xFF),
+      uint8_t((sReading.X >> 0) & 0xFF),
+      uint8_t((sReading.Y >> 8) & 0xFF),
+      uint8_t((sReading.Y >> 0) & 0xFF),
+      uint8_t((sReading.Z >> 8) & 0xFF),
+      uint8_t((sReading.Z >> 0) & 0xFF),
+      uint8_t((sReading.Temp >> 8) & 0xFF),
+      uint8_t((sReading.Temp >> 0) & 0xFF),
+   };
+   m_cPacketControlInterface.SendPacket(CPacketControlInterface::CPacket::EType::GET_ACCEL_READING,
+                                        punTxData,
+                                        sizeof(punTxData),
+                                        sTelemetry.AccelTimestamp);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ExecDDSSpeedStream(const CPacketControlInterface::CPacket& c_packet) {
+   /* Stream the velocities of each control step, bit 0 of the options adds the
+      accelerometer X, Y and Z readings to each sample */
+   const uint8_t* punRxData = c_packet.GetDataPointer();
+   bool bAccelerometer = (c_packet.GetDataLength() > 2) && (punRxData[2] & 0x01);
+   m_cDDSSpeedStream.Configure(punRxData[0], punRxData[1], bAccelerometer ? 5 : 2);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadTargetVelocity(uint8_t* pun_data) {
+   int16_t nLeftVelocity, nRightVelocity;
+   m_cDifferentialDriveSystem.GetTargetVelocity(nLeftVelocity, nRightVelocity);
+   pun_data[0] = uint8_t((nLeftVelocity >> 8) & 0xFF);
+   pun_data[1] = uint8_t((nLeftVelocity >> 0) & 0xFF);
+   pun_data[2] = uint8_t((nRightVelocity >> 8) & 0xFF);
+   pun_data[3] = uint8_t((nRightVelocity >> 0) & 0xFF);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::WriteTargetVelocity(const uint8_t* pun_data) {
+   int16_t nLeftVelocity, nRightVelocity;
+   reinterpret_cast<uint16_t&>(nLeftVelocity) = (pun_data[0] << 8) | pun_data[1];
+   reinterpret_cast<uint16_t&>(nRightVelocity) = (pun_data[2] << 8) | pun_data[3];
+   m_cDifferentialDriveSystem.SetTargetVelocity(nLeftVelocity, nRightVelocity);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadVelocity(uint8_t* pun_data) {
+   int16_t nLeftVelocity = m_cDifferentialDriveSystem.GetLeftVelocity();
+   int16_t nRightVelocity = m_cDifferentialDriveSystem.GetRightVelocity();
+   pun_data[0] = uint8_t((nLeftVelocity >> 8) & 0xFF);
+   pun_data[1] = uint8_t((nLeftVelocity >> 0) & 0xFF);
+   pun_data[2] = uint8_t((nRightVelocity >> 8) & 0xFF);
+   pun_data[3] = uint8_t((nRightVelocity >> 0) & 0xFF);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadPIDParams(uint8_t* pun_data) {
+   float pfParams[3];
+   m_cDifferentialDriveSystem.GetPIDParams(pfParams[0], pfParams[1], pfParams[2]);
+   for(uint8_t unIdx = 0; unIdx < 3; unIdx++) {
+      uint32_t unData = reinterpret_cast<uint32_t&>(pfParams[unIdx]);
+      pun_data[4 * unIdx + 0] = uint8_t((unData >> 24) & 0xFF);
+      pun_data[4 * unIdx + 1] = uint8_t((unData >> 16) & 0xFF);
+      pun_data[4 * unIdx + 2] = uint8_t((unData >> 8 ) & 0xFF);
+      pun_data[4 * unIdx + 3] = uint8_t((unData >> 0 ) & 0xFF);
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::WritePIDParams(const uint8_t* pun_data) {
+   float pfParams[3];
+   for(uint8_t unIdx = 0; unIdx < 3; unIdx++) {
+      uint32_t unData = (uint32_t(pun_data[4 * unIdx + 0]) << 24) |
+                        (uint32_t(pun_data[4 * unIdx + 1]) << 16) |
+                        (uint32_t(pun_data[4 * unIdx + 2]) << 8 ) |
+                        (uint32_t(pun_data[4 * unIdx + 3]) << 0 );
+      pfParams[unIdx] = reinterpret_cast<float&>(unData);
+   }
+   m_cDifferentialDriveSystem.SetPIDParams(pfParams[0], pfParams[1], pfParams[2]);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadAccelReading(uint8_t* pun_data) {
+   UpdateTelemetry();
+   CAccelerometerSystem::SReading sReading = m_cTelemetry.Get().AccelReading;
+   pun_data[0] = uint8_t((sReading.X >> 8) & 0xFF);
+   pun_data[1] = uint8_t((sReading.X >> 0) & 0xFF);
+   pun_data[2] = uint8_t((sReading.Y >> 8) & 0xFF);
+   pun_data[3] = uint8_t((sReading.Y >> 0) & 0xFF);
+   pun_data[4] = uint8_t((sReading.Z >> 8) & 0xFF);
+   pun_data[5] = uint8_t((sReading.Z >> 0) & 0xFF);
+   pun_data[6] = uint8_t((sReading.Temp >> 8) & 0xFF);
+   pun_data[7] = uint8_t((sReading.Temp >> 0) & 0xFF);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::ReadDDSEnable(uint8_t* pun_data) {
+   pun_data[0] = m_cDifferentialDriveSystem.IsEnabled() ? 0x01 : 0x00;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CFirmware::WriteDDSEnable(const uint8_t* pun_data) {
+   if(pun_data[0] == 0) {
+      m_cDifferentialDriveSystem.Disable();
+   }
+   else {
+      m_cDifferentialDriveSystem.Enable();
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
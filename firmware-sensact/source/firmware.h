@@ -17,6 +17,23 @@
 
 #include <differential_drive_system.h>
 #include <accelerometer_system.h>
+#include <snapshot.h>
+#include <delta_stream.h>
+#include <rule_engine.h>
+
+/* reported by GET_CAPABILITIES, the build id is set by the Makefile */
+#define BOARD_TYPE 0x01
+#ifndef FIRMWARE_BUILD_ID
+#define FIRMWARE_BUILD_ID 0
+#endif
+
+/* control table of the sensor-actuator board, all fields are big endian
+   0x00 int16_t[2] target velocity left, right (read/write)
+   0x04 int16_t[2] measured velocity left, right
+   0x08 float[3]   PID parameters Kp, Ki, Kd (read/write)
+   0x14 int16_t[4] accelerometer X, Y, Z, temperature
+   0x1C uint8_t    differential drive system enable (read/write) */
+#define CONTROL_TABLE_SIZE 0x1D
 
 class CFirmware {
 public:
@@ -24,10 +41,6 @@ public:
       return _firmware;
    }
 
-   void SetFilePointer(FILE* ps_huart) {
-      m_psHUART = ps_huart;
-   }
-
    CHUARTController& GetHUARTController() {
       return m_cHUARTController;
    }
@@ -40,11 +53,63 @@ public:
 
 private:
 
+   /* Packet handlers */
+   void ExecPacket(const CPacketControlInterface::CPacket& c_packet);
+   void ExecBatch(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSubscriptions();
+   void ExecScheduled();
+   void ExecSubscribe(const CPacketControlInterface::CPacket& c_packet);
+   void ExecUnsubscribe(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetFraming(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetReplyOptions(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetBaud(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSchedule(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetLinkStats(const CPacketControlInterface::CPacket& c_packet);
+   void ExecReadRange(const CPacketControlInterface::CPacket& c_packet);
+   void ExecWriteRange(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetCapabilities(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetRule(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetRuleStatus(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetDDSEnable(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetDDSParams(const CPacketControlInterface::CPacket& c_packet);
+   void ExecSetDDSSpeed(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetDDSSpeed(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetUptime(const CPacketControlInterface::CPacket& c_packet);
+   void ExecGetAccelReading(const CPacketControlInterface::CPacket& c_packet);
+   void ExecDDSSpeedStream(const CPacketControlInterface::CPacket& c_packet);
+
+   /* Packet dispatch table */
+   static const CPacketControlInterface::SHandler<CFirmware> m_psPacketHandlers[];
+
+   /* Control table fields */
+   void ReadTargetVelocity(uint8_t* pun_data);
+   void WriteTargetVelocity(const uint8_t* pun_data);
+   void ReadVelocity(uint8_t* pun_data);
+   void ReadPIDParams(uint8_t* pun_data);
+   void WritePIDParams(const uint8_t* pun_data);
+   void ReadAccelReading(uint8_t* pun_data);
+   void ReadDDSEnable(uint8_t* pun_data);
+   void WriteDDSEnable(const uint8_t* pun_data);
+
+   /* Control table */
+   static const CPacketControlInterface::SField<CFirmware> m_psControlTable[];
+
+   /* Refresh the telemetry snapshot if it was not read in the current control step */
+   void UpdateTelemetry();
+
+   /* Run the rules of the current control step */
+   void StepRules();
+
+   /* Add the sample of a control step to the speed stream */
+   void StepDDSSpeedStream(uint8_t un_control_step);
+
    /* private constructor */
    CFirmware() :
       m_cHUARTController(CHUARTController::instance()),
       m_cTWController(CTWController::GetInstance()),
-      m_cPacketControlInterface(m_cHUARTController) {     
+      m_cPacketControlInterface(m_cHUARTController),
+      m_bTelemetryValid(false),
+      m_unTelemetryControlStep(0) {     
 
       /* Enable interrupts */
       sei();
@@ -61,11 +126,22 @@ private:
    CDifferentialDriveSystem m_cDifferentialDriveSystem;
    CAccelerometerSystem m_cAccelerometerSystem;
 
-   static CFirmware _firmware;
+   /* Telemetry, refreshed on demand at most once per control step and copied into replies */
+   struct STelemetry {
+      CAccelerometerSystem::SReading AccelReading;
+      uint32_t AccelTimestamp;
+   };
+   CSnapshot<STelemetry> m_cTelemetry;
+   bool m_bTelemetryValid;
+   uint8_t m_unTelemetryControlStep;
+
+   /* Reactions uploaded by the host */
+   CRuleEngine m_cRuleEngine;
 
-public: // TODO, don't make these public
-    /* File structs for fprintf */
-   FILE* m_psHUART;
+   /* Velocities and optionally accelerometer readings of every control step */
+   CDeltaStream m_cDDSSpeedStream;
+
+   static CFirmware _firmware;
 };
 
 #endif
@@ -13,49 +13,313 @@ CHUARTController CHUARTController::_hardware_serial;
 
 // Interrupt Routines and Data ////////////////////////////////////////////////////////////////
 
-// Define constants and variables for buffering incoming serial data.  We're
-// using a ring buffer (I think), in which head is the index of the location
-// to which to write the next incoming character and tail is the index of the
-// location from which to read.
+// The receive interrupt is the only producer of the receive ring and the
+// transmit interrupt the only consumer of the transmit ring, the main loop
+// is on the other side of both rings.
+
+CRingBuffer<HUART_RX_BUFFER_SIZE> rx_buffer;
+CRingBuffer<HUART_TX_BUFFER_SIZE> tx_buffer;
+CHUARTController::SStatistics statistics =  { 0, 0, 0, 0, 0, 0 };
+
+// Frame that is matched in the receive interrupt and the handler that is called
+// when it has been received completely. A match only starts at the byte after a
+// marker byte, which ends the previous frame
+const uint8_t* emergency_frame = nullptr;
+uint8_t emergency_frame_length = 0;
+uint8_t emergency_frame_index = 0;
+uint8_t emergency_frame_anchored = 1;
+void (*emergency_handler)() = nullptr;
+
+// Handler that is called when the transmitter has become idle, tx_complete
+// replaces the TXC flag which is cleared when the interrupt is executed
+void (*tx_drained_handler)() = nullptr;
+volatile bool tx_complete = false;
+
+// Timebase that is copied when the byte that ends a frame is received, the copy
+// is converted into time by the main loop
+const volatile uint8_t* rx_timer_periods = nullptr;
+uint16_t rx_timer_period_ticks = 0;
+uint8_t rx_timer_microseconds_per_tick = 0;
+uint8_t rx_marker = 0;
+uint16_t rx_marker_ticks = 0;
+uint8_t rx_marker_pending = 0;
+uint8_t rx_marker_periods = 0;
+
+// Error flags and byte that the receive interrupt hands over to the C path
+uint8_t rx_status = 0;
+uint8_t rx_byte = 0;
 
-CHUARTController::SRingBuffer rx_buffer  =  { { 0 }, 0, 0 };
-CHUARTController::SRingBuffer tx_buffer  =  { { 0 }, 0, 0 };
+/****************************************/
+/****************************************/
+
+/* receive path in C, the error flags are the only bits of the status */
+static inline void receive_byte(uint8_t status, uint8_t c)
+{
+   // errors are rare, so a single test keeps them off the common path
+   if (status != 0) {
+      if (status & _BV(DOR0)) {
+         statistics.RxOverruns++;
+      }
+      if (status & _BV(FE0)) {
+         statistics.FrameErrors++;
+      }
+      if (status & _BV(UPE0)) {
+         statistics.ParityErrors++;
+         return;
+      }
+   }
+   if (!rx_buffer.Push(c)) {
+      statistics.RxDrops++;
+   }
+   if (c == rx_marker && rx_timer_periods != nullptr) {
+      // the counter is read before the flag, see GetRxMarkerAge
+      rx_marker_ticks = HUART_RX_TIMER_COUNT;
+      rx_marker_pending = HUART_RX_TIMER_PENDING;
+      rx_marker_periods = *rx_timer_periods;
+   }
+   if (emergency_frame_length != 0) {
+      // a byte that does not continue the match ends it, a new match can only
+      // start at the beginning of a frame
+      if (c == emergency_frame[emergency_frame_index] &&
+          (emergency_frame_index != 0 || emergency_frame_anchored)) {
+         if (++emergency_frame_index == emergency_frame_length) {
+            emergency_frame_index = 0;
+            emergency_handler();
+         }
+      }
+      else {
+         emergency_frame_index = 0;
+      }
+      emergency_frame_anchored = (c == rx_marker);
+   }
+}
+
+#if defined(__AVR__)
+
+/****************************************/
+/****************************************/
+
+/* continues the receive interrupt for the bytes that its fast path hands over.
+   It is entered by a jump with the return address of the interrupt on the
+   stack, so it saves what it uses and returns with reti like an interrupt */
+extern "C" void __vector_usart_rx_slow(void) __attribute__((signal, used));
+
+void __vector_usart_rx_slow(void)
+{
+   receive_byte(rx_status, rx_byte);
+}
+
+/****************************************/
+/****************************************/
+
+/* receive interrupt. The fast path queues the byte and advances the emergency
+   matcher, it only saves the registers that it uses. A byte with errors, the
+   marker byte, a byte that finds the ring full and the last byte of the
+   emergency frame are handed over to __vector_usart_rx_slow, before anything
+   has been changed. r1 is not assumed to be zero, the interrupt can run
+   between a multiplication and the code that clears r1 */
+ISR(USART_RX_vect, ISR_NAKED)
+{
+   __asm__ __volatile__ (
+      "push r24                          \n\t"
+      "in   r24, __SREG__                \n\t"
+      "push r24                          \n\t"
+      "push r25                          \n\t"
+      "push r26                          \n\t"
+      "push r27                          \n\t"
+      "push r30                          \n\t"
+      "push r31                          \n\t"
+      // the error flags are only valid until UDR0 is read
+      "lds  r24, %[ucsra]                \n\t"
+      "lds  r25, %[udr]                  \n\t"
+      "andi r24, %[errors]               \n\t"
+      "brne 2f                           \n\t"
+      "lds  r24, %[marker]               \n\t"
+      "cp   r25, r24                     \n\t"
+      "breq 3f                           \n\t"
+      // r26 is the head and r27 the head after the byte has been queued
+      "lds  r26, %[rx]+%[head]           \n\t"
+      "mov  r27, r26                     \n\t"
+      "inc  r27                          \n\t"
+      "andi r27, %[rx_mask]              \n\t"
+      "lds  r24, %[rx]+%[rx_tail]        \n\t"
+      "cp   r27, r24                     \n\t"
+      "brne 4f                           \n\t"
+      "3:                                \n\t"
+      "clr  r24                          \n\t"
+      "2:                                \n\t"
+      "sts  %[status], r24               \n\t"
+      "sts  %[byte], r25                 \n\t"
+      "pop  r31                          \n\t"
+      "pop  r30                          \n\t"
+      "pop  r27                          \n\t"
+      "pop  r26                          \n\t"
+      "pop  r25                          \n\t"
+      "pop  r24                          \n\t"
+      "out  __SREG__, r24                \n\t"
+      "pop  r24                          \n\t"
+      "jmp  __vector_usart_rx_slow       \n\t"
+      "4:                                \n\t"
+      "lds  r24, %[length]               \n\t"
+      "tst  r24                          \n\t"
+      "breq 1f                           \n\t"
+      "lds  r24, %[index]                \n\t"
+      "tst  r24                          \n\t"
+      "brne 5f                           \n\t"
+      // a match only starts after the marker, the index stays 0
+      "lds  r30, %[anchored]             \n\t"
+      "tst  r30                          \n\t"
+      "breq 6f                           \n\t"
+      "5:                                \n\t"
+      "lds  r30, %[frame]                \n\t"
+      "lds  r31, %[frame]+1              \n\t"
+      "add  r30, r24                     \n\t"
+      "brcc 7f                           \n\t"
+      "inc  r31                          \n\t"
+      "7:                                \n\t"
+      "ld   r30, Z                       \n\t"
+      // a byte that does not continue the match ends it, the index becomes 0
+      "cpse r25, r30                     \n\t"
+      "ldi  r24, 0xFF                    \n\t"
+      "inc  r24                          \n\t"
+      "lds  r30, %[length]               \n\t"
+      "cp   r24, r30                     \n\t"
+      "breq 3b                           \n\t"
+      "6:                                \n\t"
+      "sts  %[index], r24                \n\t"
+      // the byte is not the marker
+      "clr  r30                          \n\t"
+      "sts  %[anchored], r30             \n\t"
+      "1:                                \n\t"
+      "mov  r30, r26                     \n\t"
+      "clr  r31                          \n\t"
+      "subi r30, lo8(-(%[rx]))           \n\t"
+      "sbci r31, hi8(-(%[rx]))           \n\t"
+      "st   Z, r25                       \n\t"
+      "sts  %[rx]+%[head], r27           \n\t"
+      "pop  r31                          \n\t"
+      "pop  r30                          \n\t"
+      "pop  r27                          \n\t"
+      "pop  r26                          \n\t"
+      "pop  r25                          \n\t"
+      "pop  r24                          \n\t"
+      "out  __SREG__, r24                \n\t"
+      "pop  r24                          \n\t"
+      "reti                              \n\t"
+      :
+      : [ucsra] "n" (_SFR_MEM_ADDR(UCSR0A)),
+        [udr] "n" (_SFR_MEM_ADDR(UDR0)),
+        [errors] "M" (_BV(DOR0) | _BV(FE0) | _BV(UPE0)),
+        [marker] "i" (&rx_marker),
+        [rx] "i" (&rx_buffer),
+        [head] "n" (CRingBuffer<HUART_RX_BUFFER_SIZE>::HEAD_OFFSET),
+        [rx_tail] "n" (CRingBuffer<HUART_RX_BUFFER_SIZE>::TAIL_OFFSET),
+        [rx_mask] "M" (HUART_RX_BUFFER_SIZE - 1),
+        [status] "i" (&rx_status),
+        [byte] "i" (&rx_byte),
+        [frame] "i" (&emergency_frame),
+        [length] "i" (&emergency_frame_length),
+        [index] "i" (&emergency_frame_index),
+        [anchored] "i" (&emergency_frame_anchored)
+   );
+}
+
+/****************************************/
+/****************************************/
+
+/* transmit interrupt, it only saves the registers that it uses */
+ISR(USART_UDRE_vect, ISR_NAKED)
+{
+   __asm__ __volatile__ (
+      "push r24                          \n\t"
+      "in   r24, __SREG__                \n\t"
+      "push r24                          \n\t"
+      "push r25                          \n\t"
+      "push r30                          \n\t"
+      "push r31                          \n\t"
+      "lds  r25, %[tx]+%[tail]           \n\t"
+      "lds  r24, %[tx]+%[tx_head]        \n\t"
+      "cp   r25, r24                     \n\t"
+      "breq 1f                           \n\t"
+      // there is more data in the output buffer, send the next byte
+      "mov  r30, r25                     \n\t"
+      "clr  r31                          \n\t"
+      "subi r30, lo8(-(%[tx]))           \n\t"
+      "sbci r31, hi8(-(%[tx]))           \n\t"
+      "ld   r24, Z                       \n\t"
+      "sts  %[udr], r24                  \n\t"
+      "inc  r25                          \n\t"
+      "andi r25, %[tx_mask]              \n\t"
+      "sts  %[tx]+%[tail], r25           \n\t"
+      "2:                                \n\t"
+      "pop  r31                          \n\t"
+      "pop  r30                          \n\t"
+      "pop  r25                          \n\t"
+      "pop  r24                          \n\t"
+      "out  __SREG__, r24                \n\t"
+      "pop  r24                          \n\t"
+      "reti                              \n\t"
+      // buffer empty, so disable interrupts
+      "1:                                \n\t"
+      "lds  r24, %[ucsrb]                \n\t"
+      "andi r24, %[udrie]                \n\t"
+      "sts  %[ucsrb], r24                \n\t"
+      "rjmp 2b                           \n\t"
+      :
+      : [udr] "n" (_SFR_MEM_ADDR(UDR0)),
+        [ucsrb] "n" (_SFR_MEM_ADDR(UCSR0B)),
+        [udrie] "M" (uint8_t(~_BV(UDRIE0))),
+        [tx] "i" (&tx_buffer),
+        [tx_head] "n" (CRingBuffer<HUART_TX_BUFFER_SIZE>::HEAD_OFFSET),
+        [tail] "n" (CRingBuffer<HUART_TX_BUFFER_SIZE>::TAIL_OFFSET),
+        [tx_mask] "M" (HUART_TX_BUFFER_SIZE - 1)
+   );
+}
+
+#else
 
 /****************************************/
 /****************************************/
 
-/* receive interrupt */
+/* receive interrupt of builds for other processors, e.g. the host build */
 ISR(USART_RX_vect)
 {
-   if (bit_is_clear(UCSR0A, UPE0)) {
-      unsigned int i = (rx_buffer.head + 1) % SERIAL_BUFFER_SIZE;
-      if (i != rx_buffer.tail) {
-         rx_buffer.buffer[rx_buffer.head] = UDR0;
-         rx_buffer.head = i;
-      }
-   } 
-   else {
-      unsigned char c = UDR0;
-   };
+   // the error flags are only valid until UDR0 is read
+   uint8_t status = UCSR0A;
+   unsigned char c = UDR0;
+   receive_byte(status & (_BV(DOR0) | _BV(FE0) | _BV(UPE0)), c);
 }
 
 /****************************************/
 /****************************************/
 
-/* transmit interrupt */
+/* transmit interrupt of builds for other processors */
 ISR(USART_UDRE_vect)
 {
-   if (tx_buffer.head == tx_buffer.tail) {
+   uint8_t c;
+   if (tx_buffer.Pop(c)) {
+      // There is more data in the output buffer. Send the next byte
+      UDR0 = c;
+   }
+   else {
       // Buffer empty, so disable interrupts
 
       //cbi(UCSR0B, UDRIE0);
       UCSR0B &= ~(_BV(UDRIE0));
    }
-   else {
-      // There is more data in the output buffer. Send the next byte
-      unsigned char c = tx_buffer.buffer[tx_buffer.tail];
-      tx_buffer.tail = (tx_buffer.tail + 1) % SERIAL_BUFFER_SIZE;
-      UDR0 = c;
+}
+
+#endif
+
+/****************************************/
+/****************************************/
+
+/* transmit complete interrupt, only enabled while a drained handler is set */
+ISR(USART_TX_vect)
+{
+   tx_complete = true;
+   if (tx_drained_handler != nullptr) {
+      tx_drained_handler();
    }
 }
 
@@ -65,6 +329,7 @@ ISR(USART_UDRE_vect)
 CHUARTController::CHUARTController() {
    _rx_buffer = &rx_buffer;
    _tx_buffer = &tx_buffer;
+   _statistics = &statistics;
    _ubrrh = &UBRR0H;
    _ubrrl = &UBRR0L;
    _ucsra = &UCSR0A;
@@ -81,7 +346,7 @@ CHUARTController::CHUARTController() {
    *_ucsrb = 0;
 
    /* start up serial */
-   Begin(57600);
+   Begin(HUART_BAUD_RATE);
 }
 
 // Public Methods //////////////////////////////////////////////////////////////
@@ -125,10 +390,40 @@ try_again:
 /****************************************/
 /****************************************/
 
+bool CHUARTController::IsBaudRateSupported(unsigned long baud)
+{
+  // only the double speed mode is considered, Begin() uses it for all rates above 244 baud
+  if (baud == 0 || baud > F_CPU / 8) {
+    return false;
+  }
+  uint16_t baud_setting = (F_CPU / 4 / baud - 1) / 2;
+  if (baud_setting > 4095) {
+    return false;
+  }
+  unsigned long actual = F_CPU / 8 / (baud_setting + 1);
+  unsigned long error = (actual > baud) ? (actual - baud) : (baud - actual);
+  return (error * 40 <= baud);
+}
+
+/****************************************/
+/****************************************/
+
+bool CHUARTController::IsTransmitting()
+{
+  // TXC is cleared whenever bytes are queued and is set once the ring and the shift register are empty
+  if (transmitting && _tx_buffer->IsEmpty() && ((*_ucsra & _BV(TXC0)) || tx_complete)) {
+    transmitting = false;
+  }
+  return transmitting;
+}
+
+/****************************************/
+/****************************************/
+
 void CHUARTController::End()
 {
   // wait for transmission of outgoing data
-  while (_tx_buffer->head != _tx_buffer->tail);
+  while (!_tx_buffer->IsEmpty());
 
   //cbi(*_ucsrb, _rxen);
   //cbi(*_ucsrb, _txen);
@@ -138,67 +433,69 @@ void CHUARTController::End()
   *_ucsrb &= ~(_BV(_rxen) | _BV(_txen) | _BV(_rxcie) | _BV(_udrie));
   
   // clear any received data
-  _rx_buffer->head = _rx_buffer->tail;
+  _rx_buffer->Clear();
 }
 
 /****************************************/
 /****************************************/
 
-int CHUARTController::Available(void)
-{
-  return (int)(SERIAL_BUFFER_SIZE + _rx_buffer->head - _rx_buffer->tail) % SERIAL_BUFFER_SIZE;
+void CHUARTController::Flush() {
+  // UDR is kept full while the buffer is not empty, so TXC triggers when EMPTY && SENT
+  while (transmitting && ! ((*_ucsra & _BV(TXC0)) || tx_complete));
+  transmitting = false;
 }
 
 /****************************************/
 /****************************************/
 
-int CHUARTController::Peek(void)
-{
-  if (_rx_buffer->head == _rx_buffer->tail) {
-    return -1;
-  } else {
-    return _rx_buffer->buffer[_rx_buffer->tail];
+uint8_t CHUARTController::Write(uint8_t c) {
+  // If the output buffer is full, the byte is refused instead of waiting for
+  // the interrupt handler to empty it, the caller decides whether to retry
+  if (!_tx_buffer->Push(c)) {
+    _statistics->TxRejects++;
+    return 0;
   }
+
+  StartTransmitter();
+  
+  return 1;
 }
 
 /****************************************/
 /****************************************/
 
-uint8_t CHUARTController::Read(void)
-{
-  // if the head isn't ahead of the tail, we don't have any characters
-  if (_rx_buffer->head == _rx_buffer->tail) {
-    return -1;
-  } else {
-    uint8_t c = _rx_buffer->buffer[_rx_buffer->tail];
-    _rx_buffer->tail = (unsigned int)(_rx_buffer->tail + 1) % SERIAL_BUFFER_SIZE;
-    return c;
+uint8_t CHUARTController::WriteBlock(const uint8_t* pun_data, uint8_t un_length) {
+  uint8_t unQueued = _tx_buffer->PushBlock(pun_data, un_length);
+  if (unQueued != 0) {
+    StartTransmitter();
   }
+  return unQueued;
 }
 
 /****************************************/
 /****************************************/
 
-void CHUARTController::Flush() {
-  // UDR is kept full while the buffer is not empty, so TXC triggers when EMPTY && SENT
-  while (transmitting && ! (*_ucsra & _BV(TXC0)));
-  transmitting = false;
+uint8_t CHUARTController::TrySend(const uint8_t* pun_data, uint8_t un_length) {
+  uint8_t unAccepted = WriteBlock(pun_data, un_length);
+  // the caller keeps the refused bytes and decides whether to retry
+  _statistics->TxRejects += un_length - unAccepted;
+  return unAccepted;
 }
 
 /****************************************/
 /****************************************/
 
-uint8_t CHUARTController::Write(uint8_t c) {
-  unsigned int i = (_tx_buffer->head + 1) % SERIAL_BUFFER_SIZE;
-	
-  // If the output buffer is full, there's nothing for it other than to 
-  // wait for the interrupt handler to empty it a bit
-  // ???: return 0 here instead?
-  while (i == _tx_buffer->tail); // os sleep
-	
-  _tx_buffer->buffer[_tx_buffer->head] = c;
-  _tx_buffer->head = i;
+void CHUARTController::CommitTx(uint8_t un_count) {
+  if (un_count != 0) {
+    _tx_buffer->Commit(un_count);
+    StartTransmitter();
+  }
+}
+
+/****************************************/
+/****************************************/
 
+void CHUARTController::StartTransmitter() {
   //sbi(*_ucsrb, _udrie);
   *_ucsrb |= _BV(_udrie);
 
@@ -207,10 +504,120 @@ uint8_t CHUARTController::Write(uint8_t c) {
 
   //sbi(*_ucsra, TXC0);
   *_ucsra |= _BV(TXC0);
-  
-  return 1;
+  tx_complete = false;
+}
+
+/****************************************/
+/****************************************/
+
+void CHUARTController::SetEmergencyHandler(const uint8_t* pun_frame, uint8_t un_length, void (*pf_handler)()) {
+  uint8_t unSREG = SREG;
+  cli();
+  emergency_frame = pun_frame;
+  emergency_frame_length = (pf_handler != nullptr) ? un_length : 0;
+  emergency_frame_index = 0;
+  emergency_frame_anchored = 1;
+  emergency_handler = pf_handler;
+  SREG = unSREG;
 }
 
 /****************************************/
 /****************************************/
 
+void CHUARTController::SetTxDrainedHandler(void (*pf_handler)()) {
+  uint8_t unSREG = SREG;
+  cli();
+  tx_drained_handler = pf_handler;
+  if (pf_handler != nullptr) {
+    *_ucsrb |= _BV(TXCIE0);
+  }
+  else {
+    *_ucsrb &= ~(_BV(TXCIE0));
+  }
+  SREG = unSREG;
+}
+
+/****************************************/
+/****************************************/
+
+void CHUARTController::SetRxTimebase(const volatile uint8_t* pun_periods,
+                                     uint16_t un_period_ticks,
+                                     uint8_t un_microseconds_per_tick) {
+  uint8_t unSREG = SREG;
+  cli();
+  rx_timer_periods = pun_periods;
+  rx_timer_period_ticks = un_period_ticks;
+  rx_timer_microseconds_per_tick = un_microseconds_per_tick;
+  SREG = unSREG;
+}
+
+/****************************************/
+/****************************************/
+
+void CHUARTController::SetRxMarker(uint8_t un_marker) {
+  rx_marker = un_marker;
+}
+
+/****************************************/
+/****************************************/
+
+uint32_t CHUARTController::GetRxMarkerAge() {
+  if (rx_timer_periods == nullptr) {
+    return 0;
+  }
+  uint8_t unSREG = SREG;
+  cli();
+  uint16_t unTicks = HUART_RX_TIMER_COUNT;
+  uint8_t unPending = HUART_RX_TIMER_PENDING;
+  uint8_t unPeriods = *rx_timer_periods;
+  uint16_t unMarkerTicks = rx_marker_ticks;
+  uint8_t unMarkerPending = rx_marker_pending;
+  uint8_t unMarkerPeriods = rx_marker_periods;
+  SREG = unSREG;
+  // a period that ended while its interrupt was pending has only been counted if the
+  // counter was read after it wrapped around, i.e. if it is still in the first half
+  if (unPending && unTicks < rx_timer_period_ticks / 2) {
+    unPeriods++;
+  }
+  if (unMarkerPending && unMarkerTicks < rx_timer_period_ticks / 2) {
+    unMarkerPeriods++;
+  }
+  uint32_t unElapsedTicks = uint8_t(unPeriods - unMarkerPeriods) * uint32_t(rx_timer_period_ticks) +
+    unTicks - unMarkerTicks;
+  return unElapsedTicks * rx_timer_microseconds_per_tick;
+}
+
+/****************************************/
+/****************************************/
+
+bool CHUARTController::WriteFrame(const uint8_t* pun_header, uint8_t un_header_length,
+                                  const uint8_t* pun_data, uint8_t un_data_length,
+                                  const uint8_t* pun_footer, uint8_t un_footer_length) {
+  if (FreeSpace() < (unsigned int)un_header_length + un_data_length + un_footer_length) {
+    _statistics->TxDrops++;
+    return false;
+  }
+  // the space has been checked, so each part is queued completely
+  _tx_buffer->PushBlock(pun_header, un_header_length);
+  _tx_buffer->PushBlock(pun_data, un_data_length);
+  _tx_buffer->PushBlock(pun_footer, un_footer_length);
+
+  StartTransmitter();
+
+  return true;
+}
+
+/****************************************/
+/****************************************/
+
+CHUARTController::SStatistics CHUARTController::GetStatistics() {
+  // the receive counters are updated by the interrupt
+  uint8_t unSREG = SREG;
+  cli();
+  SStatistics sStatistics = *_statistics;
+  SREG = unSREG;
+  return sStatistics;
+}
+
+/****************************************/
+/****************************************/
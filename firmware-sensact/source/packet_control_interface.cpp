@@ -1,117 +1,18 @@
 
-#include <firmware.h>
-
 #include "packet_control_interface.h"
 
 /***********************************************************/
 /***********************************************************/
 
 CPacketControlInterface::CPacket::EType CPacketControlInterface::CPacket::GetType() const {
-   switch(m_unTypeId) {
-   /* uptime and voltage */
-   case 0x00:
-      return EType::GET_UPTIME;
-      break;
-   case 0x01:
-      return EType::GET_BATT_LVL;
-      break;     
+   return static_cast<EType>(m_unTypeId);
+}
 
-   /* differential driving system */
-   case 0x10:
-      return EType::SET_DDS_ENABLE;
-      break;
-   case 0x11:
-      return EType::SET_DDS_SPEED;
-      break;
-   case 0x13:
-      return EType::GET_DDS_SPEED;
-      break;
-   case 0x14:
-      return EType::SET_DDS_PARAMS;
-      break;
-   case 0x15:
-      return EType::GET_DDS_PARAMS;
+/***********************************************************/
+/***********************************************************/
 
-   /* manipulator */
-   case 0x60:
-      return EType::GET_CHARGER_STATUS;
-      break;
-   case 0x70:
-      return EType::SET_LIFT_ACTUATOR_POSITION;
-      break;      
-   case 0x71:
-      return EType::GET_LIFT_ACTUATOR_POSITION;
-      break;      
-   case 0x72:
-      return EType::SET_LIFT_ACTUATOR_SPEED;
-      break;
-   case 0x73:
-      return EType::GET_LIMIT_SWITCH_STATE;
-      break;
-   case 0x74:
-      return EType::CALIBRATE_LIFT_ACTUATOR;
-      break;
-   case 0x75:
-      return EType::EMER_STOP_LIFT_ACTUATOR;
-      break;
-   case 0x76:
-      return EType::GET_LIFT_ACTUATOR_STATE;
-      break;
-   case 0x80:
-      return EType::SET_EM_CHARGE_ENABLE;
-      break;
-   case 0x81:
-      return EType::SET_EM_DISCHARGE_MODE;
-      break;
-   case 0x82:
-      return EType::GET_EM_ACCUM_VOLTAGE;
-      break;
-   case 0x90:
-      return EType::GET_RF_RANGE;
-      break;
-   case 0x91:
-      return EType::GET_RF_AMBIENT;
-      break;
-   case 0xA0:
-      return EType::READ_NFC;
-      break;
-   case 0xA1:
-      return EType::WRITE_NFC;
-      break;
-   case 0xC0:
-      return EType::READ_SMBUS_BYTE;
-      break;
-   case 0xC1:
-      return EType::READ_SMBUS_BYTE_DATA;
-      break;
-   case 0xC2:
-      return EType::READ_SMBUS_WORD_DATA;
-      break;
-   case 0xC3:
-      return EType::READ_SMBUS_BLOCK_DATA;
-      break;
-   case 0xC4:
-      return EType::READ_SMBUS_I2C_BLOCK_DATA;
-      break;
-   case 0xD0:
-      return EType::WRITE_SMBUS_BYTE;
-      break;
-   case 0xD1:
-      return EType::WRITE_SMBUS_BYTE_DATA;
-      break;
-   case 0xD2:
-      return EType::WRITE_SMBUS_WORD_DATA;
-      break;
-   case 0xD3:
-      return EType::WRITE_SMBUS_BLOCK_DATA;
-      break;
-   case 0xD4:
-      return EType::WRITE_SMBUS_I2C_BLOCK_DATA;
-      break;
-   default:
-      return EType::INVALID;
-      break;
-   }
+uint8_t CPacketControlInterface::CPacket::GetTypeId() const {
+   return m_unTypeId;
 }
 
 /***********************************************************/
@@ -145,145 +46,955 @@ CPacketControlInterface::EState CPacketControlInterface::GetState() const {
 /***********************************************************/
 /***********************************************************/
 
-void CPacketControlInterface::SendPacket(CPacket::EType e_type,
+bool CPacketControlInterface::SendPacket(CPacket::EType e_type,
                                          const uint8_t* pun_tx_data,
                                          uint8_t un_tx_data_length) {
+   if(m_bBatchActive) {
+      uint8_t unBatchSpace = sizeof(m_punBatchBuffer) - m_unBatchLength;
+      /* flush the batch reply if this record does not fit into it */
+      if(m_unBatchLength != 0 && un_tx_data_length + 2 > unBatchSpace) {
+         bool bQueued = WriteFrame(CPacket::EType::BATCH, m_punBatchBuffer, m_unBatchLength);
+         m_unBatchLength = 0;
+         if(!bQueued) {
+            return false;
+         }
+      }
+      /* records that do not fit into an empty batch reply are sent on their own */
+      if(un_tx_data_length > sizeof(m_punBatchBuffer) - 2) {
+         return WriteMessage(e_type, pun_tx_data, un_tx_data_length);
+      }
+      m_punBatchBuffer[m_unBatchLength++] = static_cast<uint8_t>(e_type);
+      m_punBatchBuffer[m_unBatchLength++] = un_tx_data_length;
+      for(uint8_t unIdx = 0; unIdx < un_tx_data_length; unIdx++) {
+         m_punBatchBuffer[m_unBatchLength++] = pun_tx_data[unIdx];
+      }
+      return true;
+   }
+   else {
+      return WriteMessage(e_type, pun_tx_data, un_tx_data_length);
+   }
+}
 
-   uint8_t punTxBuffer[TX_COMMAND_BUFFER_LENGTH];
-   uint8_t unTxBufferPointer = 0;
-   /* Check if the data will fit into the buffer */
-   if(un_tx_data_length + NON_DATA_SIZE > TX_COMMAND_BUFFER_LENGTH)
-      return;
+/***********************************************************/
+/***********************************************************/
 
-   punTxBuffer[unTxBufferPointer++] = PREAMBLE1;
-   punTxBuffer[unTxBufferPointer++] = PREAMBLE2;
-   punTxBuffer[unTxBufferPointer++] = static_cast<uint8_t>(e_type);
-   punTxBuffer[unTxBufferPointer++] = un_tx_data_length;
-   while(unTxBufferPointer < DATA_START_OFFSET + un_tx_data_length) {
-      punTxBuffer[unTxBufferPointer] = pun_tx_data[unTxBufferPointer - DATA_START_OFFSET];
-      unTxBufferPointer++;
+bool CPacketControlInterface::SendPacket(CPacket::EType e_type,
+                                         const uint8_t* pun_tx_data,
+                                         uint8_t un_tx_data_length,
+                                         uint32_t un_timestamp) {
+   uint8_t punTxData[TX_COMMAND_BUFFER_LENGTH - NON_DATA_SIZE - SEQUENCE_FIELD_SIZE];
+   if(!(m_unReplyOptions & REPLY_OPTION_TIMESTAMP) ||
+      un_tx_data_length > sizeof(punTxData) - TIMESTAMP_FIELD_SIZE) {
+      return SendPacket(e_type, pun_tx_data, un_tx_data_length);
+   }
+   for(uint8_t unIdx = 0; unIdx < un_tx_data_length; unIdx++) {
+      punTxData[unIdx] = pun_tx_data[unIdx];
    }
-   punTxBuffer[unTxBufferPointer++] = ComputeChecksum(punTxBuffer, TX_COMMAND_BUFFER_LENGTH);
-   punTxBuffer[unTxBufferPointer++] = POSTAMBLE1;
-   punTxBuffer[unTxBufferPointer++] = POSTAMBLE2;
+   punTxData[un_tx_data_length + 0] = uint8_t((un_timestamp >> 24) & 0xFF);
+   punTxData[un_tx_data_length + 1] = uint8_t((un_timestamp >> 16) & 0xFF);
+   punTxData[un_tx_data_length + 2] = uint8_t((un_timestamp >> 8 ) & 0xFF);
+   punTxData[un_tx_data_length + 3] = uint8_t((un_timestamp >> 0 ) & 0xFF);
+   return SendPacket(e_type, punTxData, un_tx_data_length + TIMESTAMP_FIELD_SIZE);
+}
+
+/***********************************************************/
+/***********************************************************/
 
-   for(uint8_t unIdx = 0; unIdx < unTxBufferPointer; unIdx++)
-      m_cController.Write(punTxBuffer[unIdx]);
+void CPacketControlInterface::BeginBatch() {
+   /* a reply that is still deferred is dropped, the failed attempt counted it in TxDrops */
+   m_bBatchPending = false;
+   m_bBatchActive = true;
+   m_unBatchLength = 0;
 }
 
 /***********************************************************/
 /***********************************************************/
 
-void CPacketControlInterface::Reset() {
-   m_unRxBufferPointer = 0;
-   m_unUsedBufferLength = 0;
-   m_unReparseOffset = RX_COMMAND_BUFFER_LENGTH;
-   m_eState = EState::SRCH_PREAMBLE1;
+void CPacketControlInterface::EndBatch() {
+   m_bBatchActive = false;
+   /* the reply is also sent when empty, so that every BATCH packet is answered. If the
+      transmit ring is full, the reply is kept and sent by StepTxMessage */
+   if(!WriteFrame(CPacket::EType::BATCH, m_punBatchBuffer, m_unBatchLength)) {
+      m_bBatchPending = true;
+      m_bBatchSequence = m_bReplyActive && m_bReplySequence;
+      m_unBatchSequence = m_unReplySequence;
+   }
 }
 
 /***********************************************************/
 /***********************************************************/
 
-void CPacketControlInterface::AdjustRxBuffer() {
-   /* search for the beginning of new packet */
-   for(m_unReparseOffset = 1; m_unReparseOffset < m_unUsedBufferLength; m_unReparseOffset++)
-      if(m_punRxBuffer[m_unReparseOffset] == PREAMBLE1)
+bool CPacketControlInterface::Subscribe(CPacket::EType e_type, uint8_t un_period) {
+   SSubscription* psFree = nullptr;
+   for(SSubscription& sSubscription : m_psSubscriptions) {
+      if(sSubscription.Period != 0 && sSubscription.Type == static_cast<uint8_t>(e_type)) {
+         /* update the period of an existing subscription */
+         psFree = &sSubscription;
          break;
+      }
+      if(sSubscription.Period == 0 && psFree == nullptr) {
+         psFree = &sSubscription;
+      }
+   }
+   if(psFree == nullptr) {
+      return false;
+   }
+   psFree->Type = static_cast<uint8_t>(e_type);
+   psFree->Period = un_period;
+   psFree->Countdown = un_period;
+   psFree->Due = false;
+   return true;
+}
 
-   /* shift data down in buffer, move the new packet to the beginning of the buffer*/
-   for(uint8_t unBufferIdx = m_unReparseOffset;
-       unBufferIdx < m_unUsedBufferLength;
-       unBufferIdx++)
-      m_punRxBuffer[unBufferIdx - m_unReparseOffset] = m_punRxBuffer[unBufferIdx];
+/***********************************************************/
+/***********************************************************/
 
-   m_unUsedBufferLength -= m_unReparseOffset;
-   m_unRxBufferPointer = 0;
-   m_eState = EState::SRCH_PREAMBLE1;
+void CPacketControlInterface::Unsubscribe(CPacket::EType e_type) {
+   for(SSubscription& sSubscription : m_psSubscriptions) {
+      if(sSubscription.Type == static_cast<uint8_t>(e_type)) {
+         sSubscription.Period = 0;
+         sSubscription.Due = false;
+      }
+   }
 }
 
 /***********************************************************/
 /***********************************************************/
 
-void CPacketControlInterface::ReceiveFrame(uint8_t *pun_data, uint8_t un_length) {
-   /* check if the checksum are valid */
-   uint8_t unCheckSum = ComputeChecksum(pun_data, RX_COMMAND_BUFFER_LENGTH);
-   if(pun_data[un_length + CHECKSUM_OFFSET] == unCheckSum){
-      /* At this point we assume we have a valid command */
-      m_eState = EState::RECV_COMMAND;
-      /* Populate the packet fields */
-      m_cPacket = CPacket(m_punRxBuffer[TYPE_OFFSET],
-                          m_punRxBuffer[DATA_LENGTH_OFFSET],
-                          &m_punRxBuffer[DATA_START_OFFSET]);
+void CPacketControlInterface::UnsubscribeAll() {
+   for(SSubscription& sSubscription : m_psSubscriptions) {
+      sSubscription.Period = 0;
+      sSubscription.Due = false;
    }
 }
 
-void CPacketControlInterface::ProcessInput() {
-   uint8_t unRxByte = 0;
-   uint8_t m_unReparseOffset = RX_COMMAND_BUFFER_LENGTH;
+/***********************************************************/
+/***********************************************************/
 
-   if(m_eState == EState::RECV_COMMAND) {
-      /* we received a command in the last call, prepare for the next one */
-      m_eState = EState::SRCH_PREAMBLE1;
-      AdjustRxBuffer();
-   }
-
-   while(m_eState != EState::RECV_COMMAND) {
-      /* if the pointer goes to the end of the buffer, ask for more data, or quit*/
-      if(m_unRxBufferPointer < m_unUsedBufferLength) {
-         unRxByte = m_punRxBuffer[m_unRxBufferPointer];
-         m_unRxBufferPointer++;
-      }     
-      else if(m_cController.Available()) {
-         unRxByte = m_cController.Read();
-         m_punRxBuffer[m_unRxBufferPointer++] = unRxByte;
-         m_unUsedBufferLength++;
+void CPacketControlInterface::StepSubscriptions() {
+   for(SSubscription& sSubscription : m_psSubscriptions) {
+      if(sSubscription.Period != 0) {
+         if(--sSubscription.Countdown == 0) {
+            sSubscription.Countdown = sSubscription.Period;
+            sSubscription.Due = true;
+         }
+      }
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+bool CPacketControlInterface::GetDueSubscription(CPacket& c_packet) {
+   /* telemetry is deferred while the transmit ring cannot take a complete frame,
+      the subscriptions stay due and are served once the ring has drained */
+   if(m_cController.FreeSpace() < TX_COMMAND_BUFFER_LENGTH) {
+      return false;
+   }
+   for(SSubscription& sSubscription : m_psSubscriptions) {
+      if(sSubscription.Due) {
+         sSubscription.Due = false;
+         c_packet = CPacket(sSubscription.Type, 0, nullptr);
+         return true;
+      }
+   }
+   return false;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+bool CPacketControlInterface::Schedule(uint32_t un_time,
+                                       uint8_t un_type,
+                                       const uint8_t* pun_data,
+                                       uint8_t un_length) {
+   /* held packets must not modify the queue while they are executed */
+   if(m_pfClock == nullptr ||
+      un_length > SCHEDULE_DATA_LENGTH ||
+      un_type == static_cast<uint8_t>(CPacket::EType::SCHEDULE) ||
+      un_type == static_cast<uint8_t>(CPacket::EType::BATCH)) {
+      return false;
+   }
+   for(SScheduledPacket& sScheduledPacket : m_psScheduledPackets) {
+      if(!sScheduledPacket.Pending) {
+         sScheduledPacket.Time = un_time;
+         sScheduledPacket.Type = un_type;
+         sScheduledPacket.Length = un_length;
+         for(uint8_t unIdx = 0; unIdx < un_length; unIdx++) {
+            sScheduledPacket.Data[unIdx] = pun_data[unIdx];
+         }
+         sScheduledPacket.Pending = true;
+         return true;
       }
-      else {
-         /* no new data coming, break while and quit this function */
+   }
+   return false;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::CancelScheduled() {
+   for(SScheduledPacket& sScheduledPacket : m_psScheduledPackets) {
+      sScheduledPacket.Pending = false;
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+bool CPacketControlInterface::GetDueScheduled(CPacket& c_packet) {
+   if(m_pfClock == nullptr) {
+      return false;
+   }
+   uint32_t unTime = m_pfClock();
+   SScheduledPacket* psDue = nullptr;
+   int32_t nLateness = 0;
+   for(SScheduledPacket& sScheduledPacket : m_psScheduledPackets) {
+      /* the difference is signed, so that the comparison survives the wrap around of the clock */
+      int32_t nScheduledLateness = static_cast<int32_t>(unTime - sScheduledPacket.Time);
+      if(sScheduledPacket.Pending && nScheduledLateness >= 0 &&
+         (psDue == nullptr || nScheduledLateness > nLateness)) {
+         psDue = &sScheduledPacket;
+         nLateness = nScheduledLateness;
+      }
+   }
+   if(psDue == nullptr) {
+      return false;
+   }
+   psDue->Pending = false;
+   c_packet = CPacket(psDue->Type, psDue->Length, psDue->Data);
+   return true;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+uint32_t CPacketControlInterface::GetTime() {
+   return (m_pfClock != nullptr) ? m_pfClock() : 0;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+bool CPacketControlInterface::SetBaudRate(uint32_t un_baud_rate) {
+   /* the clock is required to restore the previous rate */
+   if(m_pfClock == nullptr || !m_cController.IsBaudRateSupported(un_baud_rate)) {
+      return false;
+   }
+   /* the current rate is confirmed, unless it was switched to and no frame has been received since */
+   if(m_eBaudRateSwitch != EBaudRateSwitch::UNCONFIRMED ||
+      m_sStatistics.Frames != m_unBaudRateSwitchFrames) {
+      m_unFallbackBaudRate = m_unBaudRate;
+   }
+   m_unNextBaudRate = un_baud_rate;
+   m_eBaudRateSwitch = EBaudRateSwitch::PENDING;
+   return true;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+uint32_t CPacketControlInterface::GetBaudRate() const {
+   return m_unBaudRate;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+uint16_t CPacketControlInterface::GetSupportedBaudRates() {
+   static const uint32_t punBaudRates[] PROGMEM = { STANDARD_BAUD_RATES };
+   static_assert(sizeof(punBaudRates) / sizeof(punBaudRates[0]) <= 16, "too many standard baud rates");
+   uint16_t unBitmap = 0;
+   for(uint8_t unIdx = 0; unIdx < sizeof(punBaudRates) / sizeof(punBaudRates[0]); unIdx++) {
+      uint32_t unBaudRate;
+      memcpy_P(&unBaudRate, &punBaudRates[unIdx], sizeof(unBaudRate));
+      if(m_cController.IsBaudRateSupported(unBaudRate)) {
+         unBitmap |= (1 << unIdx);
+      }
+   }
+   return unBitmap;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::StepBaudRate() {
+   switch(m_eBaudRateSwitch) {
+   case EBaudRateSwitch::PENDING:
+      /* the reply is sent at the previous rate */
+      if(!m_cController.IsTransmitting()) {
+         m_unBaudRate = m_unNextBaudRate;
+         m_cController.Begin(m_unBaudRate);
+         m_unBaudRateSwitchTime = m_pfClock();
+         m_unBaudRateSwitchFrames = m_sStatistics.Frames;
+         m_eBaudRateSwitch = EBaudRateSwitch::UNCONFIRMED;
+      }
+      break;
+   case EBaudRateSwitch::UNCONFIRMED:
+      if(m_sStatistics.Frames != m_unBaudRateSwitchFrames) {
+         m_eBaudRateSwitch = EBaudRateSwitch::IDLE;
+      }
+      else if(m_pfClock() - m_unBaudRateSwitchTime > BAUD_RATE_CONFIRM_TIMEOUT) {
+         m_unBaudRate = m_unFallbackBaudRate;
+         m_cController.Begin(m_unBaudRate);
+         m_eBaudRateSwitch = EBaudRateSwitch::IDLE;
+      }
+      break;
+   default:
+      break;
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+bool CPacketControlInterface::WriteMessage(CPacket::EType e_type,
+                                           const uint8_t* pun_tx_data,
+                                           uint8_t un_tx_data_length) {
+   bool bSequence = (m_bReplyActive && m_bReplySequence);
+   uint8_t unFrameDataLength = TX_COMMAND_BUFFER_LENGTH - NON_DATA_SIZE -
+      (bSequence ? SEQUENCE_FIELD_SIZE : 0);
+   if(un_tx_data_length <= unFrameDataLength) {
+      return WriteFrame(e_type, pun_tx_data, un_tx_data_length);
+   }
+   /* a fragmented packet does not fit into the transmit ring, it is copied and its
+      fragments are sent by StepTxMessage instead of waiting for the host here */
+   if(m_bTxMessagePending || un_tx_data_length > sizeof(m_punTxMessageBuffer)) {
+      return false;
+   }
+   for(uint8_t unIdx = 0; unIdx < un_tx_data_length; unIdx++) {
+      m_punTxMessageBuffer[unIdx] = pun_tx_data[unIdx];
+   }
+   m_bTxMessagePending = true;
+   m_bTxMessageSequence = bSequence;
+   m_unTxMessageSequence = m_unReplySequence;
+   m_unTxMessageType = static_cast<uint8_t>(e_type);
+   m_unTxMessageIndex = 0;
+   m_unTxMessageOffset = 0;
+   m_unTxMessageLength = un_tx_data_length;
+   m_unTxMessageChunkLength = unFrameDataLength - FRAGMENT_HEADER_SIZE;
+   if(m_bReplyActive) {
+      m_bReplySent = true;
+   }
+   StepTxMessage();
+   return true;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::StepTxMessage() {
+   uint8_t punFragment[TX_COMMAND_BUFFER_LENGTH - NON_DATA_SIZE];
+   /* a deferred batch reply is sent before the fragments */
+   if(m_bBatchPending && m_cController.FreeSpace() >= TX_COMMAND_BUFFER_LENGTH) {
+      m_bBatchPending = !WriteFrame(CPacket::EType::BATCH, m_punBatchBuffer, m_unBatchLength,
+                                    m_bBatchSequence, m_unBatchSequence);
+   }
+   /* only send a fragment once the transmit ring can take the complete frame */
+   while(m_bTxMessagePending && m_cController.FreeSpace() >= TX_COMMAND_BUFFER_LENGTH) {
+      uint8_t unLength = m_unTxMessageLength - m_unTxMessageOffset;
+      if(unLength > m_unTxMessageChunkLength) {
+         unLength = m_unTxMessageChunkLength;
+      }
+      punFragment[0] = m_unTxMessageId;
+      punFragment[1] = m_unTxMessageIndex;
+      punFragment[2] = m_unTxMessageType;
+      if(m_unTxMessageOffset + unLength == m_unTxMessageLength) {
+         punFragment[1] |= FRAGMENT_LAST_FLAG;
+      }
+      for(uint8_t unIdx = 0; unIdx < unLength; unIdx++) {
+         punFragment[FRAGMENT_HEADER_SIZE + unIdx] = m_punTxMessageBuffer[m_unTxMessageOffset + unIdx];
+      }
+      if(!WriteFrame(CPacket::EType::FRAGMENT, punFragment, FRAGMENT_HEADER_SIZE + unLength,
+                     m_bTxMessageSequence, m_unTxMessageSequence)) {
          break;
       }
+      m_unTxMessageIndex++;
+      m_unTxMessageOffset += unLength;
+      if(m_unTxMessageOffset == m_unTxMessageLength) {
+         m_bTxMessagePending = false;
+         m_unTxMessageId++;
+      }
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+bool CPacketControlInterface::WriteFrame(CPacket::EType e_type,
+                                         const uint8_t* pun_tx_data,
+                                         uint8_t un_tx_data_length) {
+   /* Replies to a packet with a sequence id echo the id */
+   bool bQueued = WriteFrame(e_type, pun_tx_data, un_tx_data_length,
+                             m_bReplyActive && m_bReplySequence, m_unReplySequence);
+   if(m_bReplyActive) {
+      m_bReplySent = true;
+   }
+   return bQueued;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+bool CPacketControlInterface::WriteFrame(CPacket::EType e_type,
+                                         const uint8_t* pun_tx_data,
+                                         uint8_t un_tx_data_length,
+                                         bool b_sequence,
+                                         uint8_t un_sequence) {
+   /* Check if the data will fit into a frame, a legacy frame is never shorter
+      than the same frame encoded with COBS */
+   uint8_t unMaxFrameLength = un_tx_data_length + NON_DATA_SIZE + (b_sequence ? SEQUENCE_FIELD_SIZE : 0);
+   if(unMaxFrameLength > TX_COMMAND_BUFFER_LENGTH)
+      return false;
+   /* the frame is encoded directly into the transmit ring, unless the free space
+      is too short or wraps around the end of the ring before the frame would end */
+   uint8_t unSpanLength = unMaxFrameLength;
+   uint8_t* punSpan = m_cController.GetTxSpan(unSpanLength);
+   if(unSpanLength == unMaxFrameLength) {
+      m_cController.CommitTx(EncodeFrame(e_type, pun_tx_data, un_tx_data_length,
+                                         b_sequence, un_sequence, punSpan));
+      return true;
+   }
+   uint8_t punFrame[TX_COMMAND_BUFFER_LENGTH];
+   uint8_t unFrameLength = EncodeFrame(e_type, pun_tx_data, un_tx_data_length,
+                                       b_sequence, un_sequence, punFrame);
+   /* if the transmit ring is full the frame is dropped instead of waiting for the host */
+   return m_cController.WriteFrame(punFrame, unFrameLength, nullptr, 0, nullptr, 0);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+uint8_t CPacketControlInterface::EncodeFrame(CPacket::EType e_type,
+                                             const uint8_t* pun_tx_data,
+                                             uint8_t un_tx_data_length,
+                                             bool b_sequence,
+                                             uint8_t un_sequence,
+                                             uint8_t* pun_frame) const {
+   uint8_t punHeader[DATA_START_OFFSET + SEQUENCE_FIELD_SIZE] = {
+      PREAMBLE1,
+      uint8_t(b_sequence ? PREAMBLE2_SEQ : PREAMBLE2),
+      static_cast<uint8_t>(e_type),
+      un_tx_data_length,
+      un_sequence
+   };
+   uint8_t unHeaderLength = DATA_START_OFFSET + (b_sequence ? SEQUENCE_FIELD_SIZE : 0);
+   /* the checksum covers all fields between the preamble and the checksum */
+   uint8_t unChecksum = 0;
+   for(uint8_t unIdx = TYPE_OFFSET; unIdx < unHeaderLength; unIdx++) {
+      unChecksum += punHeader[unIdx];
+   }
+   for(uint8_t unIdx = 0; unIdx < un_tx_data_length; unIdx++) {
+      unChecksum += pun_tx_data[unIdx];
+   }
+   uint8_t unFrameLength = 0;
+   if(m_eFraming == EFraming::COBS) {
+      /* encode [type][length][sequence id][data][checksum] followed by the delimiter */
+      uint8_t unCodeIdx = unFrameLength++;
+      uint8_t unDecodedLength = (unHeaderLength - TYPE_OFFSET) + un_tx_data_length + CHECKSUM_FIELD_SIZE;
+      for(uint8_t unIdx = 0; unIdx < unDecodedLength; unIdx++) {
+         uint8_t unByte;
+         if(unIdx < unHeaderLength - TYPE_OFFSET) {
+            unByte = punHeader[TYPE_OFFSET + unIdx];
+         }
+         else if(unIdx < unDecodedLength - CHECKSUM_FIELD_SIZE) {
+            unByte = pun_tx_data[unIdx - (unHeaderLength - TYPE_OFFSET)];
+         }
+         else {
+            unByte = unChecksum;
+         }
+         if(unByte == COBS_DELIMITER) {
+            pun_frame[unCodeIdx] = unFrameLength - unCodeIdx;
+            unCodeIdx = unFrameLength++;
+         }
+         else {
+            pun_frame[unFrameLength++] = unByte;
+         }
+      }
+      /* frames are shorter than 254 bytes, so a code byte never reaches 0xFF */
+      pun_frame[unCodeIdx] = unFrameLength - unCodeIdx;
+      pun_frame[unFrameLength++] = COBS_DELIMITER;
+   }
+   else {
+      for(uint8_t unIdx = 0; unIdx < unHeaderLength; unIdx++) {
+         pun_frame[unFrameLength++] = punHeader[unIdx];
+      }
+      for(uint8_t unIdx = 0; unIdx < un_tx_data_length; unIdx++) {
+         pun_frame[unFrameLength++] = pun_tx_data[unIdx];
+      }
+      pun_frame[unFrameLength++] = unChecksum;
+      pun_frame[unFrameLength++] = POSTAMBLE1;
+      pun_frame[unFrameLength++] = POSTAMBLE2;
+   }
+   return unFrameLength;
+}
 
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::Log(uint8_t un_format_id,
+                                  const uint8_t* pun_args,
+                                  uint8_t un_num_args) {
+   uint8_t punTxData[TX_COMMAND_BUFFER_LENGTH - NON_DATA_SIZE];
+   /* truncate arguments that do not fit into a single frame */
+   if(un_num_args > sizeof(punTxData) - 1) {
+      un_num_args = sizeof(punTxData) - 1;
+   }
+   punTxData[0] = un_format_id;
+   for(uint8_t unIdx = 0; unIdx < un_num_args; unIdx++) {
+      punTxData[1 + unIdx] = pun_args[unIdx];
+   }
+   /* log packets are not part of the reply */
+   bool bReplyActive = m_bReplyActive;
+   m_bReplyActive = false;
+   WriteFrame(CPacket::EType::LOG, punTxData, 1 + un_num_args);
+   m_bReplyActive = bReplyActive;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::BeginReply() {
+   m_bReplyActive = true;
+   m_bReplySent = false;
+   m_bReplySequence = m_bRxSequence;
+   m_unReplySequence = m_unRxSequence;
+   m_unReplyType = m_cPacket.GetTypeId();
+   if(m_pfClock != nullptr) {
+      m_unReplyStartTime = m_pfClock();
+      m_unRxDwell = m_cController.GetRxMarkerAge();
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+bool CPacketControlInterface::EndReply() {
+   bool bQueued = true;
+   if((m_unReplyOptions & REPLY_OPTION_SERVICE_TIME) && m_pfClock != nullptr) {
+      uint32_t unServiceTime = m_pfClock() - m_unReplyStartTime;
+      uint8_t punTxData[SERVICE_TIME_ACK_SIZE] = {
+         m_unReplyType,
+         uint8_t((m_unRxDwell >> 24) & 0xFF),
+         uint8_t((m_unRxDwell >> 16) & 0xFF),
+         uint8_t((m_unRxDwell >> 8 ) & 0xFF),
+         uint8_t((m_unRxDwell >> 0 ) & 0xFF),
+         uint8_t((unServiceTime >> 24) & 0xFF),
+         uint8_t((unServiceTime >> 16) & 0xFF),
+         uint8_t((unServiceTime >> 8 ) & 0xFF),
+         uint8_t((unServiceTime >> 0 ) & 0xFF)
+      };
+      bQueued = WriteFrame(CPacket::EType::ACK, punTxData, sizeof(punTxData));
+   }
+   /* acknowledge packets with a sequence id that did not generate a reply */
+   else if(m_bReplySequence && !m_bReplySent) {
+      bQueued = WriteFrame(CPacket::EType::ACK, &m_unReplyType, 1);
+   }
+   m_bReplyActive = false;
+   return bQueued;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::Reset() {
+   m_unFrameLength = 0;
+   m_eState = (m_eFraming == EFraming::COBS) ? EState::SRCH_DELIMITER : EState::SRCH_PREAMBLE1;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::SetFraming(EFraming e_framing) {
+   /* applied by ProcessInput once the current packet has been released */
+   m_eNextFraming = e_framing;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+CPacketControlInterface::EFraming CPacketControlInterface::GetFraming() const {
+   return m_eFraming;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+const CPacketControlInterface::SStatistics& CPacketControlInterface::GetStatistics() const {
+   return m_sStatistics;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::SetReplyOptions(uint8_t un_options) {
+   m_unReplyOptions = un_options;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+uint8_t CPacketControlInterface::GetReplyOptions() const {
+   return m_unReplyOptions;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::SetClock(uint32_t (*pf_clock)()) {
+   m_pfClock = pf_clock;
+   ArmRxInterrupt();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::SetEmergencyPacket(CPacket::EType e_type,
+                                                 const uint8_t* pun_data,
+                                                 uint8_t un_data_length,
+                                                 void (*pf_handler)()) {
+   if(un_data_length > EMERGENCY_DATA_LENGTH) {
+      pf_handler = nullptr;
+   }
+   m_unEmergencyType = static_cast<uint8_t>(e_type);
+   m_unEmergencyDataLength = (pf_handler != nullptr) ? un_data_length : 0;
+   for(uint8_t unIdx = 0; unIdx < m_unEmergencyDataLength; unIdx++) {
+      m_punEmergencyData[unIdx] = pun_data[unIdx];
+   }
+   m_pfEmergencyHandler = pf_handler;
+   ArmRxInterrupt();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::ArmRxInterrupt() {
+   /* frames of each framing end with a different marker */
+   m_cController.SetRxMarker((m_eFraming == EFraming::COBS) ? COBS_DELIMITER : POSTAMBLE2);
+   /* the matcher is disarmed while its frame is encoded for the current framing */
+   m_cController.SetEmergencyHandler(nullptr, 0, nullptr);
+   if(m_pfEmergencyHandler != nullptr) {
+      uint8_t unLength = EncodeFrame(static_cast<CPacket::EType>(m_unEmergencyType),
+                                     m_punEmergencyData, m_unEmergencyDataLength,
+                                     false, 0, m_punEmergencyFrame);
+      m_cController.SetEmergencyHandler(m_punEmergencyFrame, unLength, m_pfEmergencyHandler);
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::Resynchronize() {
+   /* drop the first byte of the rejected frame, the search for the next preamble
+      continues from the following byte without moving any data */
+   m_cController.Discard(1);
+   m_eState = EState::SRCH_PREAMBLE1;
+   m_sStatistics.Resyncs++;
+   m_sStatistics.DiscardedBytes++;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::ReceiveFrame() {
+   uint8_t unDataOffset = DATA_START_OFFSET + (m_bRxSequence ? SEQUENCE_FIELD_SIZE : 0);
+   uint8_t unDataLength = m_unFrameLength - NON_DATA_SIZE - (m_bRxSequence ? SEQUENCE_FIELD_SIZE : 0);
+   /* check if the checksum is valid, this is only done once per candidate frame */
+   uint8_t unChecksum = 0;
+   for(uint8_t unOffset = TYPE_OFFSET; unOffset < unDataOffset + unDataLength;) {
+      /* sum the frame in runs, it wraps around the end of the ring at most once */
+      uint8_t unSpanLength = unDataOffset + unDataLength - unOffset;
+      const uint8_t* punSpan = m_cController.GetRxSpan(unOffset, unSpanLength);
+      for(uint8_t unIdx = 0; unIdx < unSpanLength; unIdx++) {
+         unChecksum += punSpan[unIdx];
+      }
+      unOffset += unSpanLength;
+   }
+   if(m_cController.Peek(m_unFrameLength + CHECKSUM_OFFSET) != unChecksum) {
+      m_sStatistics.ChecksumErrors++;
+      Resynchronize();
+      return;
+   }
+   /* reference the payload in place, unless it wraps around the end of the ring */
+   const uint8_t* punData = m_cController.GetRxPointer(unDataOffset, unDataLength);
+   if(punData == nullptr) {
+      m_cController.PeekBlock(unDataOffset, m_punRxBuffer, unDataLength);
+      punData = m_punRxBuffer;
+   }
+   /* At this point we assume we have a valid command */
+   m_eState = EState::RECV_COMMAND;
+   m_sStatistics.Frames++;
+   m_unRxSequence = m_bRxSequence ? m_cController.Peek(SEQUENCE_OFFSET) : 0;
+   /* Populate the packet fields */
+   m_cPacket = CPacket(m_cController.Peek(TYPE_OFFSET),
+                       unDataLength,
+                       punData);
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::ReceiveCOBSFrame() {
+   /* the frame and its delimiter are moved out of the receive ring in one block
+      and decoded in place, a decoded byte is never written ahead of the encoded
+      byte that is read next */
+   uint8_t unEncodedLength = m_unFrameLength;
+   m_cController.ReadBlock(m_punRxBuffer, unEncodedLength + 1);
+   m_unFrameLength = 0;
+   uint8_t unDecodedLength = 0;
+   bool bValid = true;
+   for(uint8_t unIdx = 0; unIdx < unEncodedLength && bValid;) {
+      uint8_t unCode = m_punRxBuffer[unIdx++];
+      for(uint8_t unCount = 1; unCount < unCode; unCount++) {
+         if(unIdx >= unEncodedLength) {
+            bValid = false;
+            break;
+         }
+         m_punRxBuffer[unDecodedLength++] = m_punRxBuffer[unIdx++];
+      }
+      /* a code below 0xFF implies a zero, unless it ends the frame */
+      if(unCode < 0xFF && unIdx < unEncodedLength) {
+         m_punRxBuffer[unDecodedLength++] = 0x00;
+      }
+   }
+   /* [type][length][data][checksum] with an optional sequence id after the length */
+   if(bValid && unDecodedLength >= TYPE_FIELD_SIZE + DATA_LENGTH_FIELD_SIZE + CHECKSUM_FIELD_SIZE) {
+      uint8_t unDataLength = m_punRxBuffer[DATA_LENGTH_OFFSET - TYPE_OFFSET];
+      uint8_t unHeaderLength = unDecodedLength - unDataLength - CHECKSUM_FIELD_SIZE;
+      if(unDataLength < unDecodedLength &&
+         (unHeaderLength == TYPE_FIELD_SIZE + DATA_LENGTH_FIELD_SIZE ||
+          unHeaderLength == TYPE_FIELD_SIZE + DATA_LENGTH_FIELD_SIZE + SEQUENCE_FIELD_SIZE)) {
+         uint8_t unChecksum = 0;
+         for(uint8_t unIdx = 0; unIdx < unDecodedLength - CHECKSUM_FIELD_SIZE; unIdx++) {
+            unChecksum += m_punRxBuffer[unIdx];
+         }
+         if(m_punRxBuffer[unDecodedLength - CHECKSUM_FIELD_SIZE] == unChecksum) {
+            m_bRxSequence = (unHeaderLength != TYPE_FIELD_SIZE + DATA_LENGTH_FIELD_SIZE);
+            m_unRxSequence = m_bRxSequence ? m_punRxBuffer[SEQUENCE_OFFSET - TYPE_OFFSET] : 0;
+            m_eState = EState::RECV_COMMAND;
+            m_sStatistics.Frames++;
+            m_cPacket = CPacket(m_punRxBuffer[0],
+                                unDataLength,
+                                &m_punRxBuffer[unHeaderLength]);
+            return;
+         }
+         m_sStatistics.ChecksumErrors++;
+      }
+   }
+   /* drop the frame, the next frame starts after the delimiter. Empty frames
+      are not counted, hosts may send extra delimiters to flush the link */
+   if(unEncodedLength != 0) {
+      m_sStatistics.Resyncs++;
+      m_sStatistics.DiscardedBytes += unEncodedLength + 1;
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::ReleaseFrame() {
+   m_cController.Discard(m_unFrameLength);
+   if(m_eFraming != m_eNextFraming) {
+      m_eFraming = m_eNextFraming;
+      ArmRxInterrupt();
+   }
+   Reset();
+}
+
+/***********************************************************/
+/***********************************************************/
+
+bool CPacketControlInterface::Reassemble() {
+   const uint8_t* punData = m_cPacket.GetDataPointer();
+   if(m_cPacket.GetDataLength() < FRAGMENT_HEADER_SIZE) {
+      m_unReassemblyIndex = 0;
+      return false;
+   }
+   uint8_t unChunkLength = m_cPacket.GetDataLength() - FRAGMENT_HEADER_SIZE;
+   uint8_t unIndex = punData[1] & ~FRAGMENT_LAST_FLAG;
+   if(unIndex == 0) {
+      /* the first fragment starts a new packet and abandons a previous one */
+      m_unReassemblyId = punData[0];
+      m_unReassemblyType = punData[2];
+      m_unReassemblyLength = 0;
+   }
+   else if(unIndex != m_unReassemblyIndex ||
+           punData[0] != m_unReassemblyId ||
+           punData[2] != m_unReassemblyType) {
+      /* a fragment is missing, drop the packet */
+      m_unReassemblyIndex = 0;
+      return false;
+   }
+   if(unChunkLength > REASSEMBLY_BUFFER_LENGTH - m_unReassemblyLength) {
+      m_unReassemblyIndex = 0;
+      return false;
+   }
+   for(uint8_t unIdx = 0; unIdx < unChunkLength; unIdx++) {
+      m_punReassemblyBuffer[m_unReassemblyLength++] = punData[FRAGMENT_HEADER_SIZE + unIdx];
+   }
+   if(punData[1] & FRAGMENT_LAST_FLAG) {
+      /* the reply to the packet echoes the sequence id of the last fragment */
+      m_unReassemblyIndex = 0;
+      m_cPacket = CPacket(m_unReassemblyType,
+                          m_unReassemblyLength,
+                          m_punReassemblyBuffer);
+      return true;
+   }
+   m_unReassemblyIndex = unIndex + 1;
+   /* acknowledge intermediate fragments that carry a sequence id */
+   BeginReply();
+   EndReply();
+   return false;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CPacketControlInterface::ProcessInput() {
+   StepBaudRate();
+
+   if(m_eState == EState::RECV_COMMAND) {
+      /* we received a command in the last call, release its frame from the ring */
+      ReleaseFrame();
+   }
+
+   /* resume sending the fragments of a pending packet */
+   StepTxMessage();
+
+   /* the next packet stays in the receive ring until its reply can be queued,
+      the same way that subscriptions are deferred. The replies of the next
+      packet are also held until the pending packet has been sent */
+   if(m_bTxMessagePending || m_bBatchPending ||
+      m_cController.FreeSpace() < TX_COMMAND_BUFFER_LENGTH) {
+      return;
+   }
+
+   /* frames are validated in place inside the receive ring. Each state only
+      inspects a fixed position of the candidate frame, so a call either waits
+      for more data or advances the state machine without rescanning */
+   for(;;) {
+      uint8_t unAvailable = m_cController.Available();
       switch(m_eState) {
       case EState::SRCH_PREAMBLE1:
-         if(unRxByte != PREAMBLE1) {
-            AdjustRxBuffer();
+         if(unAvailable == 0) {
+            return;
          }
          else {
-            m_eState = EState::SRCH_PREAMBLE2;
+            /* drop the run of bytes before the next preamble in one step */
+            uint8_t unSpanLength = unAvailable;
+            const uint8_t* punSpan = m_cController.GetRxSpan(0, unSpanLength);
+            uint8_t unSkip = 0;
+            while(unSkip < unSpanLength && punSpan[unSkip] != PREAMBLE1) {
+               unSkip++;
+            }
+            m_cController.Discard(unSkip);
+            m_sStatistics.DiscardedBytes += unSkip;
+            if(unSkip < unSpanLength) {
+               m_eState = EState::SRCH_PREAMBLE2;
+            }
          }
          break;
       case EState::SRCH_PREAMBLE2:
-         if(unRxByte != PREAMBLE2) {
-            AdjustRxBuffer();
+         if(unAvailable < PREAMBLE_SIZE) {
+            return;
+         }
+         if(m_cController.Peek(1) != PREAMBLE2 && m_cController.Peek(1) != PREAMBLE2_SEQ) {
+            Resynchronize();
          }
          else {
+            m_bRxSequence = (m_cController.Peek(1) == PREAMBLE2_SEQ);
             m_eState = EState::SRCH_POSTAMBLE1;
+            m_unFrameLength = 0;
          }
          break;
       case EState::SRCH_POSTAMBLE1:
-         /* check pointer position with the packet length declared in the packet */
-         if(m_unRxBufferPointer > DATA_LENGTH_OFFSET &&
-            m_unRxBufferPointer == m_punRxBuffer[DATA_LENGTH_OFFSET] + NON_DATA_SIZE - 1) {
-            if(unRxByte != POSTAMBLE1) {
-               /* reached packet length declared in the packet, but the data is not a postamble*/
-               AdjustRxBuffer();
+         if(m_unFrameLength == 0) {
+            /* wait for the header and validate the declared packet length */
+            if(unAvailable < DATA_START_OFFSET) {
+               return;
             }
-            else {
-               /* unRxByte == POSTAMBLE1 */
-               m_eState = EState::SRCH_POSTAMBLE2;
+            uint16_t unFrameLength = m_cController.Peek(DATA_LENGTH_OFFSET) + NON_DATA_SIZE +
+               (m_bRxSequence ? SEQUENCE_FIELD_SIZE : 0);
+            if(unFrameLength > RX_COMMAND_BUFFER_LENGTH) {
+               Resynchronize();
+               break;
             }
+            m_unFrameLength = unFrameLength;
+         }
+         if(unAvailable < m_unFrameLength - 1) {
+            return;
+         }
+         if(m_cController.Peek(m_unFrameLength - 2) != POSTAMBLE1) {
+            /* reached packet length declared in the packet, but the data is not a postamble */
+            Resynchronize();
+         }
+         else {
+            m_eState = EState::SRCH_POSTAMBLE2;
          }
          break;
       case EState::SRCH_POSTAMBLE2:
-         if(m_unRxBufferPointer > DATA_LENGTH_OFFSET &&
-            m_unRxBufferPointer == m_punRxBuffer[DATA_LENGTH_OFFSET] + NON_DATA_SIZE) {
-            if(unRxByte == POSTAMBLE2) {
-               ReceiveFrame(m_punRxBuffer, m_unRxBufferPointer);
+         if(unAvailable < m_unFrameLength) {
+            return;
+         }
+         if(m_cController.Peek(m_unFrameLength - 1) != POSTAMBLE2) {
+            Resynchronize();
+         }
+         else {
+            ReceiveFrame();
+            if(m_eState == EState::RECV_COMMAND) {
+               /* fragments are only returned once the packet is complete */
+               if(m_cPacket.GetType() != CPacket::EType::FRAGMENT || Reassemble()) {
+                  return;
+               }
+               ReleaseFrame();
             }
          }
          break;
-      default:
+      case EState::SRCH_DELIMITER:
+         /* m_unFrameLength counts the bytes of the frame scanned so far */
+         if(unAvailable <= m_unFrameLength) {
+            return;
+         }
+         if(m_cController.Peek(m_unFrameLength) == COBS_DELIMITER) {
+            ReceiveCOBSFrame();
+            if(m_eState == EState::RECV_COMMAND) {
+               /* fragments are only returned once the packet is complete */
+               if(m_cPacket.GetType() != CPacket::EType::FRAGMENT || Reassemble()) {
+                  return;
+               }
+               ReleaseFrame();
+            }
+         }
+         else if(++m_unFrameLength > COBS_MAX_ENCODED_LENGTH) {
+            /* frame is too long, drop it up to the next delimiter */
+            m_cController.Discard(m_unFrameLength);
+            m_sStatistics.Resyncs++;
+            m_sStatistics.DiscardedBytes += m_unFrameLength;
+            m_unFrameLength = 0;
+            m_eState = EState::SKIP_FRAME;
+         }
+         break;
+      case EState::SKIP_FRAME:
+         if(unAvailable == 0) {
+            return;
+         }
+         else {
+            /* drop the run of bytes up to and including the next delimiter in one step */
+            uint8_t unSpanLength = unAvailable;
+            const uint8_t* punSpan = m_cController.GetRxSpan(0, unSpanLength);
+            uint8_t unSkip = 0;
+            while(unSkip < unSpanLength) {
+               if(punSpan[unSkip++] == COBS_DELIMITER) {
+                  m_eState = EState::SRCH_DELIMITER;
+                  break;
+               }
+            }
+            m_cController.Discard(unSkip);
+            m_sStatistics.DiscardedBytes += unSkip;
+         }
          break;
+      default:
+         return;
       }
    }
 }
@@ -308,6 +1019,12 @@ const char* CPacketControlInterface::StateToString(CPacketControlInterface::ESta
    case EState::RECV_COMMAND:
       return "RECV_COMMAND";
       break;
+   case EState::SRCH_DELIMITER:
+      return "SRCH_DELIMITER";
+      break;
+   case EState::SKIP_FRAME:
+      return "SKIP_FRAME";
+      break;
    default:
       return "UNKNOWN STATE";
       break;
@@ -320,17 +1037,3 @@ const char* CPacketControlInterface::StateToString(CPacketControlInterface::ESta
 const CPacketControlInterface::CPacket& CPacketControlInterface::GetPacket() const {
    return m_cPacket;
 }
-
-/***********************************************************/
-/***********************************************************/
-
-uint8_t CPacketControlInterface::ComputeChecksum(uint8_t* pun_buf_data, uint8_t un_buf_length) {
-   uint8_t unChecksum = 0;
-   for(uint8_t unIdx = TYPE_OFFSET;
-       unIdx < ((DATA_START_OFFSET + pun_buf_data[DATA_LENGTH_OFFSET] > un_buf_length) ?
-          un_buf_length : (DATA_START_OFFSET + pun_buf_data[DATA_LENGTH_OFFSET]));
-       unIdx++) {
-      unChecksum += pun_buf_data[unIdx];
-   }
-   return unChecksum;
-}
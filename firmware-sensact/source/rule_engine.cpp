@@ -0,0 +1,235 @@
+
+#include "rule_engine.h"
+
+/****************************************/
+/****************************************/
+
+CRuleEngine::CRuleEngine() :
+   m_psRules() {}
+
+/****************************************/
+/****************************************/
+
+bool CRuleEngine::Load(uint8_t un_slot,
+                       uint8_t un_budget,
+                       const uint8_t* pun_program,
+                       uint8_t un_length) {
+   if(un_slot >= RULE_ENGINE_NUM_SLOTS) {
+      return false;
+   }
+   SRule& sRule = m_psRules[un_slot];
+   sRule.Length = 0;
+   sRule.Budget = un_budget;
+   sRule.EdgeState = 0;
+   sRule.Executions = 0;
+   if(un_length == 0 || un_budget == 0) {
+      sRule.Status = EStatus::EMPTY;
+      return true;
+   }
+   sRule.Status = EStatus::INVALID;
+   if(un_length > RULE_PROGRAM_LENGTH) {
+      return false;
+   }
+   /* decode the program, bit n marks the start of the instruction at n */
+   uint32_t unInstructions = 0;
+   for(uint8_t unPc = 0; unPc < un_length;) {
+      uint8_t unSize = GetInstructionSize(&pun_program[unPc], un_length - unPc);
+      if(unSize == 0) {
+         return false;
+      }
+      unInstructions |= (1UL << unPc);
+      unPc += unSize;
+   }
+   /* jumping to the end of the program stops the rule */
+   unInstructions |= (1UL << un_length);
+   for(uint8_t unPc = 0; unPc < un_length;) {
+      EOpcode eOpcode = static_cast<EOpcode>(pun_program[unPc]);
+      uint8_t unSize = GetInstructionSize(&pun_program[unPc], un_length - unPc);
+      if(eOpcode == EOpcode::JZ || eOpcode == EOpcode::JMP) {
+         int16_t nTarget = unPc + unSize + reinterpret_cast<const int8_t&>(pun_program[unPc + 1]);
+         if(nTarget < 0 || nTarget > un_length || !(unInstructions & (1UL << nTarget))) {
+            return false;
+         }
+      }
+      else if(eOpcode == EOpcode::EXEC) {
+         if(!IsExecutable(pun_program[unPc + 1])) {
+            return false;
+         }
+      }
+      unPc += unSize;
+   }
+   for(uint8_t unIdx = 0; unIdx < un_length; unIdx++) {
+      sRule.Program[unIdx] = pun_program[unIdx];
+   }
+   sRule.Length = un_length;
+   sRule.Status = EStatus::READY;
+   return true;
+}
+
+/****************************************/
+/****************************************/
+
+void CRuleEngine::GetStatus(uint8_t un_slot, uint8_t* pun_data) const {
+   const SRule& sRule = m_psRules[un_slot];
+   pun_data[0] = static_cast<uint8_t>(sRule.Status);
+   pun_data[1] = sRule.Budget;
+   pun_data[2] = sRule.Length;
+   pun_data[3] = uint8_t((sRule.Executions >> 8) & 0xFF);
+   pun_data[4] = uint8_t((sRule.Executions >> 0) & 0xFF);
+}
+
+/****************************************/
+/****************************************/
+
+bool CRuleEngine::IsExecutable(uint8_t un_type) {
+   /* rules may only drive actuators and write the control table. Packets that
+      configure the link, nest other packets or replace the rules are rejected,
+      so that a rule can not lock the host out */
+   switch(static_cast<CPacketControlInterface::CPacket::EType>(un_type)) {
+   case CPacketControlInterface::CPacket::EType::WRITE_RANGE:
+   case CPacketControlInterface::CPacket::EType::SET_DDS_ENABLE:
+   case CPacketControlInterface::CPacket::EType::SET_DDS_SPEED:
+   case CPacketControlInterface::CPacket::EType::SET_ACTUATOR_POWER_ENABLE:
+   case CPacketControlInterface::CPacket::EType::SET_LIFT_ACTUATOR_POSITION:
+   case CPacketControlInterface::CPacket::EType::SET_LIFT_ACTUATOR_SPEED:
+   case CPacketControlInterface::CPacket::EType::EMER_STOP_LIFT_ACTUATOR:
+   case CPacketControlInterface::CPacket::EType::SET_EM_CHARGE_ENABLE:
+   case CPacketControlInterface::CPacket::EType::SET_EM_DISCHARGE_MODE:
+      return true;
+   default:
+      return false;
+   }
+}
+
+/****************************************/
+/****************************************/
+
+uint8_t CRuleEngine::GetInstructionSize(const uint8_t* pun_instruction, uint8_t un_remaining) {
+   uint8_t unSize = 0;
+   switch(static_cast<EOpcode>(pun_instruction[0])) {
+   case EOpcode::END:
+   case EOpcode::DUP:
+   case EOpcode::DROP:
+   case EOpcode::ADD:
+   case EOpcode::SUB:
+   case EOpcode::ABS:
+   case EOpcode::NEG:
+   case EOpcode::LT:
+   case EOpcode::GT:
+   case EOpcode::EQ:
+   case EOpcode::AND:
+   case EOpcode::OR:
+   case EOpcode::NOT:
+   case EOpcode::EDGE:
+      unSize = 1;
+      break;
+   case EOpcode::PUSH8:
+   case EOpcode::LOAD8:
+   case EOpcode::LOAD16:
+   case EOpcode::JZ:
+   case EOpcode::JMP:
+      unSize = 2;
+      break;
+   case EOpcode::PUSH16:
+      unSize = 3;
+      break;
+   case EOpcode::EXEC:
+      /* the length of the packet data is the second operand */
+      if(un_remaining >= 3) {
+         unSize = 3 + pun_instruction[2];
+      }
+      break;
+   }
+   return (unSize <= un_remaining) ? unSize : 0;
+}
+
+/****************************************/
+/****************************************/
+
+bool CRuleEngine::Evaluate(SRule& s_rule,
+                           SMachine& s_machine,
+                           EOpcode e_opcode,
+                           const uint8_t* pun_operands) {
+   int16_t nA, nB;
+   switch(e_opcode) {
+   case EOpcode::PUSH8:
+      return Push(s_machine, reinterpret_cast<const int8_t&>(pun_operands[0]));
+   case EOpcode::PUSH16:
+      return Push(s_machine, int16_t((pun_operands[0] << 8) | pun_operands[1]));
+   case EOpcode::DUP:
+      return Pop(s_machine, nA) && Push(s_machine, nA) && Push(s_machine, nA);
+   case EOpcode::DROP:
+      return Pop(s_machine, nA);
+   case EOpcode::ABS:
+      return Pop(s_machine, nA) && Push(s_machine, (nA < 0) ? -nA : nA);
+   case EOpcode::NEG:
+      return Pop(s_machine, nA) && Push(s_machine, -nA);
+   case EOpcode::NOT:
+      return Pop(s_machine, nA) && Push(s_machine, (nA == 0) ? 1 : 0);
+   case EOpcode::EDGE:
+      {
+         if(!Pop(s_machine, nA)) {
+            return false;
+         }
+         uint8_t unMask = (s_machine.Edge < 8) ? (1 << s_machine.Edge) : 0;
+         s_machine.Edge++;
+         bool bPrevious = (s_rule.EdgeState & unMask);
+         if(nA != 0) {
+            s_rule.EdgeState |= unMask;
+         }
+         else {
+            s_rule.EdgeState &= ~unMask;
+         }
+         return Push(s_machine, (nA != 0 && !bPrevious) ? 1 : 0);
+      }
+   default:
+      break;
+   }
+   /* binary operations */
+   if(!Pop(s_machine, nB) || !Pop(s_machine, nA)) {
+      return false;
+   }
+   switch(e_opcode) {
+   case EOpcode::ADD:
+      return Push(s_machine, nA + nB);
+   case EOpcode::SUB:
+      return Push(s_machine, nA - nB);
+   case EOpcode::LT:
+      return Push(s_machine, (nA < nB) ? 1 : 0);
+   case EOpcode::GT:
+      return Push(s_machine, (nA > nB) ? 1 : 0);
+   case EOpcode::EQ:
+      return Push(s_machine, (nA == nB) ? 1 : 0);
+   case EOpcode::AND:
+      return Push(s_machine, (nA != 0 && nB != 0) ? 1 : 0);
+   case EOpcode::OR:
+      return Push(s_machine, (nA != 0 || nB != 0) ? 1 : 0);
+   default:
+      return false;
+   }
+}
+
+/****************************************/
+/****************************************/
+
+bool CRuleEngine::Push(SMachine& s_machine, int16_t n_value) {
+   if(s_machine.Depth >= RULE_STACK_DEPTH) {
+      return false;
+   }
+   s_machine.Stack[s_machine.Depth++] = n_value;
+   return true;
+}
+
+/****************************************/
+/****************************************/
+
+bool CRuleEngine::Pop(SMachine& s_machine, int16_t& n_value) {
+   if(s_machine.Depth == 0) {
+      return false;
+   }
+   n_value = s_machine.Stack[--s_machine.Depth];
+   return true;
+}
+
+/****************************************/
+/****************************************/
@@ -0,0 +1,115 @@
+#include "capture.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/***********************************************************/
+/***********************************************************/
+
+static uint32_t ReadLittleEndian(const uint8_t* pun_data, uint8_t un_size) {
+   uint32_t unValue = 0;
+   for(uint8_t unIdx = un_size; unIdx > 0; unIdx--) {
+      unValue = (unValue << 8) | pun_data[unIdx - 1];
+   }
+   return unValue;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+static void WriteLittleEndian(uint8_t* pun_data, uint32_t un_value, uint8_t un_size) {
+   for(uint8_t unIdx = 0; unIdx < un_size; unIdx++) {
+      pun_data[unIdx] = un_value & 0xFF;
+      un_value >>= 8;
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+bool CCapture::Load(const char* pch_path) {
+   FILE* psFile = fopen(pch_path, "rb");
+   if(psFile == nullptr) {
+      return false;
+   }
+   uint8_t punHeader[CAPTURE_HEADER_SIZE];
+   if(fread(punHeader, 1, CAPTURE_HEADER_SIZE, psFile) != CAPTURE_HEADER_SIZE ||
+      memcmp(punHeader, CAPTURE_MAGIC, 4) != 0 ||
+      punHeader[4] != CAPTURE_VERSION) {
+      fclose(psFile);
+      return false;
+   }
+   m_unValidFrames = ReadLittleEndian(punHeader + 8, 4);
+   m_vecRecords.clear();
+   for(;;) {
+      uint8_t punRecordHeader[CAPTURE_RECORD_HEADER_SIZE];
+      size_t unRead = fread(punRecordHeader, 1, CAPTURE_RECORD_HEADER_SIZE, psFile);
+      if(unRead == 0) {
+         break;
+      }
+      SRecord sRecord;
+      sRecord.Time = ReadLittleEndian(punRecordHeader, 4);
+      sRecord.Data.resize(ReadLittleEndian(punRecordHeader + 4, 2));
+      /* a truncated record means that the file is damaged */
+      if(unRead != CAPTURE_RECORD_HEADER_SIZE ||
+         fread(sRecord.Data.data(), 1, sRecord.Data.size(), psFile) != sRecord.Data.size()) {
+         fclose(psFile);
+         return false;
+      }
+      m_vecRecords.push_back(sRecord);
+   }
+   fclose(psFile);
+   return true;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+bool CCapture::Save(const char* pch_path) const {
+   FILE* psFile = fopen(pch_path, "wb");
+   if(psFile == nullptr) {
+      return false;
+   }
+   uint8_t punHeader[CAPTURE_HEADER_SIZE] = {0};
+   memcpy(punHeader, CAPTURE_MAGIC, 4);
+   punHeader[4] = CAPTURE_VERSION;
+   WriteLittleEndian(punHeader + 8, m_unValidFrames, 4);
+   bool bSuccess = (fwrite(punHeader, 1, CAPTURE_HEADER_SIZE, psFile) == CAPTURE_HEADER_SIZE);
+   for(const SRecord& sRecord : m_vecRecords) {
+      uint8_t punRecordHeader[CAPTURE_RECORD_HEADER_SIZE];
+      WriteLittleEndian(punRecordHeader, sRecord.Time, 4);
+      WriteLittleEndian(punRecordHeader + 4, sRecord.Data.size(), 2);
+      bSuccess = bSuccess &&
+         fwrite(punRecordHeader, 1, CAPTURE_RECORD_HEADER_SIZE, psFile) == CAPTURE_RECORD_HEADER_SIZE &&
+         fwrite(sRecord.Data.data(), 1, sRecord.Data.size(), psFile) == sRecord.Data.size();
+   }
+   return (fclose(psFile) == 0) && bSuccess;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+void CCapture::AddRecord(uint32_t un_time, const std::vector<uint8_t>& vec_data) {
+   /* records longer than the length field allows are split */
+   for(size_t unOffset = 0; unOffset < vec_data.size(); unOffset += 0xFFFF) {
+      size_t unLength = vec_data.size() - unOffset;
+      if(unLength > 0xFFFF) {
+         unLength = 0xFFFF;
+      }
+      SRecord sRecord;
+      sRecord.Time = un_time;
+      sRecord.Data.assign(vec_data.begin() + unOffset, vec_data.begin() + unOffset + unLength);
+      m_vecRecords.push_back(sRecord);
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+uint32_t CCapture::GetByteCount() const {
+   uint32_t unByteCount = 0;
+   for(const SRecord& sRecord : m_vecRecords) {
+      unByteCount += sRecord.Data.size();
+   }
+   return unByteCount;
+}
@@ -0,0 +1,62 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <vector>
+
+/* Capture file format, all fields are little endian:
+
+   header: ['B']['B']['C']['P'][version][reserved, 3 bytes][valid frames, 4 bytes]
+   record: [time in microseconds, 4 bytes][length, 2 bytes][data, length bytes]
+
+   The header is followed by records until the end of the file. The data of a
+   record are the bytes that the microcontroller received, the time is when the
+   last of them was received, in microseconds since the start of the capture. The number of valid frames is zero for
+   captures of the real link, synthetic captures store the number of frames that
+   were sent intact so that the replay can report the dropped-frame rate */
+
+#define CAPTURE_MAGIC "BBCP"
+#define CAPTURE_VERSION 1
+#define CAPTURE_HEADER_SIZE 12
+#define CAPTURE_RECORD_HEADER_SIZE 6
+
+class CCapture {
+
+public:
+
+   struct SRecord {
+      uint32_t Time;
+      std::vector<uint8_t> Data;
+   };
+
+   CCapture() :
+      m_unValidFrames(0) {}
+
+   /* returns false if the file can not be read or is not a capture */
+   bool Load(const char* pch_path);
+
+   bool Save(const char* pch_path) const;
+
+   void AddRecord(uint32_t un_time, const std::vector<uint8_t>& vec_data);
+
+   uint32_t GetValidFrames() const {
+      return m_unValidFrames;
+   }
+
+   void SetValidFrames(uint32_t un_valid_frames) {
+      m_unValidFrames = un_valid_frames;
+   }
+
+   const std::vector<SRecord>& GetRecords() const {
+      return m_vecRecords;
+   }
+
+   uint32_t GetByteCount() const;
+
+private:
+
+   uint32_t m_unValidFrames;
+   std::vector<SRecord> m_vecRecords;
+};
+
+#endif
@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <packet_control_interface.h>
+
+/* Compares the dispatch of packets through CPacketControlInterface::Dispatch with
+   the two switches that it replaced, the mapping of the type id in
+   CPacket::GetType and the switch of CFirmware::ExecPacket with its length
+   checks. Both dispatch to the types and lengths of the firmware-sensact table,
+   the handlers only count their calls.
+
+   dispatch [-n packets] [-u percent] [-s seed] [-r passes]
+      dispatches packets of random types of the table with valid lengths, the
+      given percentage has an unknown type or an invalid length */
+
+using EType = CPacketControlInterface::CPacket::EType;
+
+/***********************************************************/
+/***********************************************************/
+
+class CBench {
+
+public:
+
+   void Exec(const CPacketControlInterface::CPacket& c_packet) {
+      m_unCalls++;
+   }
+
+   bool ExecSwitch(const CPacketControlInterface::CPacket& c_packet);
+
+   uint32_t GetCalls() const {
+      return m_unCalls;
+   }
+
+   static const CPacketControlInterface::SHandler<CBench> m_psPacketHandlers[];
+   static const uint8_t m_unPacketHandlerCount;
+
+private:
+
+   static EType GetType(uint8_t un_type_id);
+
+   /* volatile so that the compiler keeps the calls */
+   volatile uint32_t m_unCalls = 0;
+};
+
+/***********************************************************/
+/***********************************************************/
+
+/* the types and lengths of the firmware-sensact table, with the limits that
+   depend on its buffers written out */
+constexpr CPacketControlInterface::SHandler<CBench> CBench::m_psPacketHandlers[] = {
+   {EType::GET_UPTIME, 0, 0, &CBench::Exec},
+   {EType::BATCH, 0, 30, &CBench::Exec},
+   {EType::SUBSCRIBE, 2, 2, &CBench::Exec},
+   {EType::UNSUBSCRIBE, 0, 1, &CBench::Exec},
+   {EType::SET_FRAMING, 1, 1, &CBench::Exec},
+   {EType::GET_LINK_STATS, 0, 0, &CBench::Exec},
+   {EType::READ_RANGE, 2, 2, &CBench::Exec},
+   {EType::WRITE_RANGE, 1, 30, &CBench::Exec},
+   {EType::GET_CAPABILITIES, 0, 0, &CBench::Exec},
+   {EType::SET_REPLY_OPTIONS, 1, 1, &CBench::Exec},
+   {EType::SET_BAUD, 4, 4, &CBench::Exec},
+   {EType::SCHEDULE, 0, 30, &CBench::Exec},
+   {EType::SET_DDS_ENABLE, 1, 1, &CBench::Exec},
+   {EType::SET_DDS_SPEED, 4, 4, &CBench::Exec},
+   {EType::GET_DDS_SPEED, 0, 0, &CBench::Exec},
+   {EType::SET_DDS_PARAMS, 12, 12, &CBench::Exec},
+   {EType::DDS_SPEED_STREAM, 2, 3, &CBench::Exec},
+   {EType::GET_ACCEL_READING, 0, 0, &CBench::Exec},
+   {EType::SET_RULE, 2, 30, &CBench::Exec},
+   {EType::GET_RULE_STATUS, 1, 1, &CBench::Exec}
+};
+
+const uint8_t CBench::m_unPacketHandlerCount =
+   sizeof(m_psPacketHandlers) / sizeof(m_psPacketHandlers[0]);
+
+/***********************************************************/
+/***********************************************************/
+
+/* the mapping of CPacket::GetType before the table, one case per type */
+EType CBench::GetType(uint8_t un_type_id) {
+   switch(un_type_id) {
+   case 0x00: return EType::GET_UPTIME;
+   case 0x02: return EType::BATCH;
+   case 0x03: return EType::SUBSCRIBE;
+   case 0x04: return EType::UNSUBSCRIBE;
+   case 0x06: return EType::SET_FRAMING;
+   case 0x07: return EType::GET_LINK_STATS;
+   case 0x09: return EType::READ_RANGE;
+   case 0x0A: return EType::WRITE_RANGE;
+   case 0x0C: return EType::GET_CAPABILITIES;
+   case 0x0D: return EType::SET_REPLY_OPTIONS;
+   case 0x0E: return EType::SET_BAUD;
+   case 0x0F: return EType::SCHEDULE;
+   case 0x10: return EType::SET_DDS_ENABLE;
+   case 0x11: return EType::SET_DDS_SPEED;
+   case 0x13: return EType::GET_DDS_SPEED;
+   case 0x14: return EType::SET_DDS_PARAMS;
+   case 0x16: return EType::DDS_SPEED_STREAM;
+   case 0x20: return EType::GET_ACCEL_READING;
+   case 0xE0: return EType::SET_RULE;
+   case 0xE1: return EType::GET_RULE_STATUS;
+   default: return EType::INVALID;
+   }
+}
+
+/***********************************************************/
+/***********************************************************/
+
+/* the switch of CFirmware::ExecPacket before the table, each case checks its length */
+bool CBench::ExecSwitch(const CPacketControlInterface::CPacket& c_packet) {
+   uint8_t unLength = c_packet.GetDataLength();
+   switch(GetType(c_packet.GetTypeId())) {
+   case EType::GET_UPTIME:
+   case EType::GET_LINK_STATS:
+   case EType::GET_CAPABILITIES:
+   case EType::GET_DDS_SPEED:
+   case EType::GET_ACCEL_READING:
+      if(unLength == 0) { Exec(c_packet); return true; }
+      break;
+   case EType::BATCH:
+   case EType::SCHEDULE:
+      if(unLength <= 30) { Exec(c_packet); return true; }
+      break;
+   case EType::SUBSCRIBE:
+   case EType::READ_RANGE:
+      if(unLength == 2) { Exec(c_packet); return true; }
+      break;
+   case EType::UNSUBSCRIBE:
+      if(unLength <= 1) { Exec(c_packet); return true; }
+      break;
+   case EType::SET_FRAMING:
+   case EType::SET_REPLY_OPTIONS:
+   case EType::SET_DDS_ENABLE:
+   case EType::GET_RULE_STATUS:
+      if(unLength == 1) { Exec(c_packet); return true; }
+      break;
+   case EType::WRITE_RANGE:
+      if(unLength >= 1 && unLength <= 30) { Exec(c_packet); return true; }
+      break;
+   case EType::SET_BAUD:
+   case EType::SET_DDS_SPEED:
+      if(unLength == 4) { Exec(c_packet); return true; }
+      break;
+   case EType::SET_DDS_PARAMS:
+      if(unLength == 12) { Exec(c_packet); return true; }
+      break;
+   case EType::DDS_SPEED_STREAM:
+      if(unLength >= 2 && unLength <= 3) { Exec(c_packet); return true; }
+      break;
+   case EType::SET_RULE:
+      if(unLength >= 2 && unLength <= 30) { Exec(c_packet); return true; }
+      break;
+   default:
+      break;
+   }
+   return false;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+static inline uint64_t ReadCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+   return __rdtsc();
+#else
+   return 0;
+#endif
+}
+
+/***********************************************************/
+/***********************************************************/
+
+template<class F>
+static void Measure(const char* pch_name, const std::vector<CPacketControlInterface::CPacket>& vec_packets,
+                    uint32_t un_passes, F fn_dispatch) {
+   uint32_t unAccepted = 0;
+   auto tStart = std::chrono::steady_clock::now();
+   uint64_t unStartCycles = ReadCycles();
+   for(uint32_t unPass = 0; unPass < un_passes; unPass++) {
+      for(const CPacketControlInterface::CPacket& cPacket : vec_packets) {
+         unAccepted += fn_dispatch(cPacket);
+      }
+   }
+   uint64_t unCycles = ReadCycles() - unStartCycles;
+   double fTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+   double fCount = double(vec_packets.size()) * un_passes;
+   printf("   %-8s %" PRIu32 " accepted, %.2f ns/packet", pch_name, unAccepted / un_passes, fTime * 1e9 / fCount);
+#if defined(__x86_64__) || defined(__i386__)
+   printf(", %.1f cycles/packet", unCycles / fCount);
+#endif
+   printf("\n");
+}
+
+/***********************************************************/
+/***********************************************************/
+
+int main(int n_argc, char* ppch_argv[]) {
+   uint32_t unPackets = 100000;
+   uint32_t unPercent = 10;
+   uint32_t unSeed = 1;
+   uint32_t unPasses = 100;
+   int nOption;
+   while((nOption = getopt(n_argc, ppch_argv, "n:u:s:r:")) != -1) {
+      switch(nOption) {
+      case 'n': unPackets = strtoul(optarg, nullptr, 0); break;
+      case 'u': unPercent = strtoul(optarg, nullptr, 0); break;
+      case 's': unSeed = strtoul(optarg, nullptr, 0); break;
+      case 'r': unPasses = strtoul(optarg, nullptr, 0); break;
+      default:
+         fprintf(stderr, "usage: %s [-n packets] [-u percent] [-s seed] [-r passes]\n", ppch_argv[0]);
+         return EXIT_FAILURE;
+      }
+   }
+   if(unPasses == 0) {
+      unPasses = 1;
+   }
+   std::mt19937 cRandom(unSeed);
+   static const uint8_t punData[UINT8_MAX] = {0};
+   std::vector<CPacketControlInterface::CPacket> vecPackets;
+   for(uint32_t unIdx = 0; unIdx < unPackets; unIdx++) {
+      const CPacketControlInterface::SHandler<CBench>& sHandler =
+         CBench::m_psPacketHandlers[cRandom() % CBench::m_unPacketHandlerCount];
+      uint8_t unType = static_cast<uint8_t>(sHandler.Type);
+      uint8_t unLength = sHandler.MinDataLength +
+         cRandom() % (sHandler.MaxDataLength - sHandler.MinDataLength + 1);
+      if(cRandom() % 100 < unPercent) {
+         /* either type is unknown, or the length is out of range */
+         if(cRandom() % 2) {
+            unType = 0x80 + cRandom() % 0x40;
+         }
+         else {
+            unLength = sHandler.MaxDataLength + 1;
+         }
+      }
+      vecPackets.emplace_back(unType, unLength, punData);
+   }
+   CBench cBench;
+   printf("%" PRIu32 " packets, %" PRIu32 "%% invalid, %" PRIu32 " passes, %u handlers\n",
+          unPackets, unPercent, unPasses, CBench::m_unPacketHandlerCount);
+   Measure("table", vecPackets, unPasses, [&](const CPacketControlInterface::CPacket& c_packet) {
+      return CPacketControlInterface::Dispatch<CBench,
+                                               CBench::m_psPacketHandlers,
+                                               CBench::m_unPacketHandlerCount>(cBench, c_packet);
+   });
+   Measure("switch", vecPackets, unPasses, [&](const CPacketControlInterface::CPacket& c_packet) {
+      return cBench.ExecSwitch(c_packet);
+   });
+   return (cBench.GetCalls() != 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
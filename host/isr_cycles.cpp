@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include <vector>
+
+#include <sim_avr.h>
+#include <sim_elf.h>
+#include <sim_io.h>
+#include <sim_irq.h>
+#include <avr_uart.h>
+
+/* Measures the cycles of the USART interrupts of a firmware image in simavr and
+   checks them against a budget.
+
+   isr_cycles [-r cycles] [-m cycles] [-t cycles] [-k marker] [-f frames] <elf>
+      sends legacy GET_UPTIME frames and bytes that are not frames to the
+      firmware, followed by the frames given in hex with -f, e.g. the emergency
+      frame of the board. Each byte is only sent once the receive interrupt of
+      the previous byte has returned, so that every run of USART_RX_vect belongs
+      to a known byte. A run is measured from the entry of the vector table to
+      the instruction after the reti, the interrupt response is not included.
+      The longest run of USART_RX_vect for a byte other than the marker must not
+      exceed -r, for the marker, which ends a frame, -m. The longest run of
+      USART_UDRE_vect, for the replies, must not exceed -t. The exit status is
+      non-zero if a budget is exceeded or if the firmware does not enable the
+      receiver */
+
+#define USART_RX_VECTOR 18
+#define USART_UDRE_VECTOR 19
+#define VECTOR_SIZE 4
+
+/* ATmega328P data addresses */
+#define UCSR0B_ADDRESS 0xC1
+#define RXCIE0_MASK 0x80
+
+/* cycles that the firmware may take until it enables the receive interrupt,
+   and for each byte until its receive interrupt has run */
+#define STARTUP_CYCLES 80000000ULL
+#define BYTE_CYCLES 2000000ULL
+
+/***********************************************************/
+/***********************************************************/
+
+/* F0 CA [type] [length] [checksum] 53 0F, a GET_UPTIME request */
+static const uint8_t punRequest[] = {0xF0, 0xCA, 0x00, 0x00, 0x00, 0x53, 0x0F};
+
+/* bytes that are not frames, among them a false preamble */
+static const uint8_t punNoise[] = {0x00, 0x55, 0xAA, 0xF0, 0xF0, 0xCA, 0xFF, 0x53};
+
+/***********************************************************/
+/***********************************************************/
+
+class CInterruptMonitor {
+
+public:
+
+   CInterruptMonitor(avr_t* ps_avr) :
+      m_psAvr(ps_avr) {}
+
+   /* executes one instruction, returns the vector of an interrupt that has
+      returned during it, or -1 */
+   int Step(uint64_t& un_cycles) {
+      int nReturned = -1;
+      avr_run(m_psAvr);
+      uint16_t unStackPointer = GetStackPointer();
+      if(m_nVector >= 0 && unStackPointer >= m_unStackPointer + 2) {
+         nReturned = m_nVector;
+         un_cycles = m_psAvr->cycle - m_unEntryCycle;
+         m_nVector = -1;
+      }
+      if(m_nVector < 0 && m_psAvr->pc % VECTOR_SIZE == 0) {
+         int nVector = m_psAvr->pc / VECTOR_SIZE;
+         if(nVector == USART_RX_VECTOR || nVector == USART_UDRE_VECTOR) {
+            m_nVector = nVector;
+            m_unEntryCycle = m_psAvr->cycle;
+            m_unStackPointer = unStackPointer;
+         }
+      }
+      return nReturned;
+   }
+
+private:
+
+   uint16_t GetStackPointer() const {
+      return m_psAvr->data[R_SPL] | (m_psAvr->data[R_SPH] << 8);
+   }
+
+   avr_t* m_psAvr;
+   int m_nVector = -1;
+   uint64_t m_unEntryCycle = 0;
+   uint16_t m_unStackPointer = 0;
+};
+
+/***********************************************************/
+/***********************************************************/
+
+static bool ParseFrames(const char* pch_frames, std::vector<uint8_t>& vec_stream) {
+   while(*pch_frames != '\0') {
+      char* pchEnd;
+      unsigned long unByte = strtoul(pch_frames, &pchEnd, 16);
+      if(pchEnd == pch_frames || unByte > 0xFF) {
+         return false;
+      }
+      vec_stream.push_back(unByte);
+      pch_frames = pchEnd + strspn(pchEnd, " ,");
+   }
+   return true;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+int main(int n_argc, char* ppch_argv[]) {
+   static const char* pchUsage = "usage: %s [-r cycles] [-m cycles] [-t cycles] [-k marker] [-f frames] <elf>\n";
+   uint64_t unRxBudget = 0;
+   uint64_t unMarkerBudget = 0;
+   uint64_t unUdreBudget = 0;
+   uint8_t unMarker = 0x0F;
+   std::vector<uint8_t> vecStream;
+   for(unsigned int unIdx = 0; unIdx < 4; unIdx++) {
+      vecStream.insert(vecStream.end(), punRequest, punRequest + sizeof(punRequest));
+      vecStream.insert(vecStream.end(), punNoise, punNoise + sizeof(punNoise));
+   }
+   std::vector<uint8_t> vecFrames;
+   int nOption;
+   while((nOption = getopt(n_argc, ppch_argv, "r:m:t:k:f:")) != -1) {
+      switch(nOption) {
+      case 'r': unRxBudget = strtoull(optarg, nullptr, 0); break;
+      case 'm': unMarkerBudget = strtoull(optarg, nullptr, 0); break;
+      case 't': unUdreBudget = strtoull(optarg, nullptr, 0); break;
+      case 'k': unMarker = strtoul(optarg, nullptr, 0); break;
+      case 'f':
+         if(!ParseFrames(optarg, vecFrames)) {
+            fprintf(stderr, "%s: the frames must be bytes in hex\n", ppch_argv[0]);
+            return EXIT_FAILURE;
+         }
+         break;
+      default:
+         fprintf(stderr, pchUsage, ppch_argv[0]);
+         return EXIT_FAILURE;
+      }
+   }
+   if(optind != n_argc - 1) {
+      fprintf(stderr, pchUsage, ppch_argv[0]);
+      return EXIT_FAILURE;
+   }
+   vecStream.insert(vecStream.end(), vecFrames.begin(), vecFrames.end());
+   /* the replies to the last requests are sent while the next bytes arrive */
+   vecStream.insert(vecStream.end(), punRequest, punRequest + sizeof(punRequest));
+   /* load the firmware */
+   elf_firmware_t sFirmware;
+   memset(&sFirmware, 0, sizeof(sFirmware));
+   if(elf_read_firmware(ppch_argv[optind], &sFirmware) != 0) {
+      fprintf(stderr, "%s: cannot read %s\n", ppch_argv[0], ppch_argv[optind]);
+      return EXIT_FAILURE;
+   }
+   avr_t* psAvr = avr_make_mcu_by_name("atmega328p");
+   if(psAvr == nullptr) {
+      fprintf(stderr, "%s: simavr does not support the atmega328p\n", ppch_argv[0]);
+      return EXIT_FAILURE;
+   }
+   avr_init(psAvr);
+   sFirmware.frequency = F_CPU;
+   avr_load_firmware(psAvr, &sFirmware);
+   /* the bytes that the firmware sends are not needed */
+   uint32_t unFlags = 0;
+   avr_ioctl(psAvr, AVR_IOCTL_UART_GET_FLAGS('0'), &unFlags);
+   unFlags &= ~AVR_UART_FLAG_STDIO;
+   avr_ioctl(psAvr, AVR_IOCTL_UART_SET_FLAGS('0'), &unFlags);
+   avr_irq_t* psInput = avr_io_getirq(psAvr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+   CInterruptMonitor cMonitor(psAvr);
+   uint64_t unCycles;
+   /* wait for the firmware to enable the receive interrupt */
+   while(!(psAvr->data[UCSR0B_ADDRESS] & RXCIE0_MASK) || !psAvr->sreg[S_I]) {
+      if(psAvr->cycle > STARTUP_CYCLES || psAvr->state == cpu_Crashed) {
+         fprintf(stderr, "%s: the firmware did not enable the receive interrupt\n", ppch_argv[0]);
+         return EXIT_FAILURE;
+      }
+      cMonitor.Step(unCycles);
+   }
+   uint64_t unRxMaximum = 0;
+   uint64_t unMarkerMaximum = 0;
+   uint64_t unUdreMaximum = 0;
+   uint32_t unUdreCount = 0;
+   for(uint8_t unByte : vecStream) {
+      avr_raise_irq(psInput, unByte);
+      uint64_t unDeadline = psAvr->cycle + BYTE_CYCLES;
+      for(;;) {
+         if(psAvr->cycle > unDeadline || psAvr->state == cpu_Crashed) {
+            fprintf(stderr, "%s: the receive interrupt did not run for 0x%02X\n", ppch_argv[0], unByte);
+            return EXIT_FAILURE;
+         }
+         int nVector = cMonitor.Step(unCycles);
+         if(nVector == USART_UDRE_VECTOR) {
+            unUdreCount++;
+            if(unCycles > unUdreMaximum) {
+               unUdreMaximum = unCycles;
+            }
+         }
+         else if(nVector == USART_RX_VECTOR) {
+            uint64_t& unMaximum = (unByte == unMarker) ? unMarkerMaximum : unRxMaximum;
+            if(unCycles > unMaximum) {
+               unMaximum = unCycles;
+            }
+            break;
+         }
+      }
+   }
+   /* let the last replies leave the transmit ring */
+   for(uint64_t unEnd = psAvr->cycle + BYTE_CYCLES; psAvr->cycle < unEnd;) {
+      if(cMonitor.Step(unCycles) == USART_UDRE_VECTOR) {
+         unUdreCount++;
+         if(unCycles > unUdreMaximum) {
+            unUdreMaximum = unCycles;
+         }
+      }
+   }
+   printf("USART_RX_vect   at most %" PRIu64 " cycles, %" PRIu64 " for the marker\n", unRxMaximum, unMarkerMaximum);
+   printf("USART_UDRE_vect at most %" PRIu64 " cycles in %" PRIu32 " runs\n", unUdreMaximum, unUdreCount);
+   bool bPassed = true;
+   if(unRxBudget != 0 && unRxMaximum > unRxBudget) {
+      fprintf(stderr, "USART_RX_vect takes more than %" PRIu64 " cycles\n", unRxBudget);
+      bPassed = false;
+   }
+   if(unMarkerBudget != 0 && unMarkerMaximum > unMarkerBudget) {
+      fprintf(stderr, "USART_RX_vect takes more than %" PRIu64 " cycles for the marker\n", unMarkerBudget);
+      bPassed = false;
+   }
+   if(unUdreBudget != 0 && unUdreMaximum > unUdreBudget) {
+      fprintf(stderr, "USART_UDRE_vect takes more than %" PRIu64 " cycles\n", unUdreBudget);
+      bPassed = false;
+   }
+   if(unUdreCount == 0) {
+      fprintf(stderr, "the firmware did not reply, USART_UDRE_vect was not measured\n");
+      bPassed = false;
+   }
+   return bPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
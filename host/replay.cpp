@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <avr/io.h>
+#include <packet_control_interface.h>
+
+#include "capture.h"
+
+/* Replays serial captures through the receive interrupt of CHUARTController and
+   the parser of CPacketControlInterface, or generates synthetic captures with
+   known impairments.
+
+   replay [-r passes] <capture>...
+      reports the frames that were parsed, the dropped-frame rate if the capture
+      stores the number of valid frames, the resync latency, i.e. the number of
+      bytes and the time from the byte that makes the parser reject a candidate
+      frame or discard a byte to the next frame that it accepts, and the host
+      throughput over all passes, in timestamp counter cycles per byte on x86.
+      Times have the resolution of the records
+
+   replay -g <capture> [-n frames] [-p percent] [-k kinds] [-s seed] [-b baud]
+      writes a capture of legacy frames of random types and lengths, each frame
+      is preceded by an impairment with the given probability. The kinds of
+      impairments are chosen at random from the letters of -k, by default ntfc:
+         n  noise
+         t  a truncated frame
+         f  a false preamble
+         c  a frame with a corrupted byte
+         a  a chain of false preambles that each claim the longest frame, the
+            worst case for a parser that shifts its buffer after a mismatch */
+
+extern "C" void USART_RX_vect(void);
+
+/***********************************************************/
+/***********************************************************/
+
+/* the application packet types, FRAGMENT would start a reassembly */
+static const uint8_t punFrameTypes[] = {
+   0x00, 0x01, 0x10, 0x11, 0x13, 0x14, 0x15, 0x16, 0x20
+};
+
+#define MAXIMUM_FRAME_DATA_LENGTH (RX_COMMAND_BUFFER_LENGTH - NON_DATA_SIZE)
+
+/***********************************************************/
+/***********************************************************/
+
+static std::vector<uint8_t> BuildFrame(std::mt19937& c_random) {
+   uint8_t unType = punFrameTypes[c_random() % sizeof(punFrameTypes)];
+   uint8_t unLength = c_random() % (MAXIMUM_FRAME_DATA_LENGTH + 1);
+   std::vector<uint8_t> vecFrame = {PREAMBLE1, PREAMBLE2, unType, unLength};
+   uint8_t unChecksum = unType + unLength;
+   for(uint8_t unIdx = 0; unIdx < unLength; unIdx++) {
+      uint8_t unByte = c_random();
+      vecFrame.push_back(unByte);
+      unChecksum += unByte;
+   }
+   vecFrame.push_back(unChecksum);
+   vecFrame.push_back(POSTAMBLE1);
+   vecFrame.push_back(POSTAMBLE2);
+   return vecFrame;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+static int Generate(const char* pch_path, uint32_t un_frames, uint32_t un_percent,
+                    const char* pch_kinds, uint32_t un_seed, uint32_t un_baud_rate) {
+   std::mt19937 cRandom(un_seed);
+   CCapture cCapture;
+   /* ten bits per byte, start bit, eight data bits and stop bit */
+   double fByteTime = 10e6 / un_baud_rate;
+   uint32_t unByteCount = 0;
+   uint32_t unImpairments[5] = {0};
+   size_t unKindCount = strlen(pch_kinds);
+   auto fnAdd = [&](const std::vector<uint8_t>& vec_data) {
+      unByteCount += vec_data.size();
+      cCapture.AddRecord(static_cast<uint32_t>(unByteCount * fByteTime), vec_data);
+   };
+   for(uint32_t unFrame = 0; unFrame < un_frames; unFrame++) {
+      if(cRandom() % 100 < un_percent) {
+         std::vector<uint8_t> vecImpairment;
+         switch(pch_kinds[cRandom() % unKindCount]) {
+         case 'n':
+            /* line noise */
+            vecImpairment.resize(1 + cRandom() % 16);
+            for(uint8_t& unByte : vecImpairment) {
+               unByte = cRandom();
+            }
+            unImpairments[0]++;
+            break;
+         case 't':
+            /* a frame that was cut off, e.g. by a reset of the sender */
+            vecImpairment = BuildFrame(cRandom);
+            vecImpairment.resize(1 + cRandom() % (vecImpairment.size() - 1));
+            unImpairments[1]++;
+            break;
+         case 'f':
+            /* a preamble in the payload of a foreign protocol */
+            vecImpairment = {PREAMBLE1, PREAMBLE2};
+            for(uint32_t unIdx = cRandom() % 8; unIdx > 0; unIdx--) {
+               vecImpairment.push_back(cRandom());
+            }
+            unImpairments[2]++;
+            break;
+         case 'c':
+            /* a flipped bit in the data or the checksum, the frame is not valid */
+            vecImpairment = BuildFrame(cRandom);
+            vecImpairment[4 + cRandom() % (vecImpairment.size() - 6)] ^= 1 << (cRandom() % 8);
+            unImpairments[3]++;
+            break;
+         case 'a':
+            for(uint32_t unIdx = 1 + cRandom() % 8; unIdx > 0; unIdx--) {
+               vecImpairment.insert(vecImpairment.end(), {PREAMBLE1, PREAMBLE2,
+                  punFrameTypes[cRandom() % sizeof(punFrameTypes)], MAXIMUM_FRAME_DATA_LENGTH});
+            }
+            unImpairments[4]++;
+            break;
+         }
+         fnAdd(vecImpairment);
+      }
+      fnAdd(BuildFrame(cRandom));
+   }
+   cCapture.SetValidFrames(un_frames);
+   if(!cCapture.Save(pch_path)) {
+      fprintf(stderr, "could not write %s\n", pch_path);
+      return EXIT_FAILURE;
+   }
+   printf("%s: %" PRIu32 " valid frames, %" PRIu32 " bytes, %" PRIu32 " noise, "
+          "%" PRIu32 " truncated, %" PRIu32 " false preambles, %" PRIu32 " corrupted, "
+          "%" PRIu32 " preamble chains\n",
+          pch_path, un_frames, unByteCount, unImpairments[0], unImpairments[1],
+          unImpairments[2], unImpairments[3], unImpairments[4]);
+   return EXIT_SUCCESS;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+static inline uint64_t ReadCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+   return __rdtsc();
+#else
+   return 0;
+#endif
+}
+
+/***********************************************************/
+/***********************************************************/
+
+/* the statistics of the parser are 16 bit counters, the replay sums their increments */
+struct SReplayResult {
+   uint32_t Frames = 0;
+   uint32_t ChecksumErrors = 0;
+   uint32_t Resyncs = 0;
+   uint32_t DiscardedBytes = 0;
+   uint32_t Losses = 0;
+   uint64_t ResyncBytes = 0;
+   uint64_t ResyncTime = 0;
+   uint32_t MaximumResyncBytes = 0;
+   uint32_t MaximumResyncTime = 0;
+};
+
+/***********************************************************/
+/***********************************************************/
+
+static SReplayResult Replay(const CCapture& c_capture, CPacketControlInterface& c_interface) {
+   SReplayResult sResult;
+   CPacketControlInterface::SStatistics sLastStatistics = c_interface.GetStatistics();
+   bool bSynchronized = true;
+   uint32_t unLostByte = 0;
+   uint32_t unLostTime = 0;
+   uint32_t unByte = 0;
+   for(const CCapture::SRecord& sRecord : c_capture.GetRecords()) {
+      for(uint8_t unData : sRecord.Data) {
+         UCSR0A = 0;
+         UDR0 = unData;
+         USART_RX_vect();
+         unByte++;
+         /* the main loop of the firmware, the packets are only released */
+         for(;;) {
+            c_interface.ProcessInput();
+            const CPacketControlInterface::SStatistics& sStatistics =
+               c_interface.GetStatistics();
+            /* the parser reports a rejected byte through its statistics */
+            if(sStatistics.Resyncs != sLastStatistics.Resyncs ||
+               sStatistics.DiscardedBytes != sLastStatistics.DiscardedBytes) {
+               sResult.ChecksumErrors += uint16_t(sStatistics.ChecksumErrors - sLastStatistics.ChecksumErrors);
+               sResult.Resyncs += uint16_t(sStatistics.Resyncs - sLastStatistics.Resyncs);
+               sResult.DiscardedBytes += uint16_t(sStatistics.DiscardedBytes - sLastStatistics.DiscardedBytes);
+               sLastStatistics = sStatistics;
+               if(bSynchronized) {
+                  bSynchronized = false;
+                  unLostByte = unByte;
+                  unLostTime = sRecord.Time;
+               }
+            }
+            if(c_interface.GetState() != CPacketControlInterface::EState::RECV_COMMAND) {
+               break;
+            }
+            sResult.Frames++;
+            if(!bSynchronized) {
+               bSynchronized = true;
+               uint32_t unBytes = unByte - unLostByte;
+               uint32_t unTime = sRecord.Time - unLostTime;
+               sResult.Losses++;
+               sResult.ResyncBytes += unBytes;
+               sResult.ResyncTime += unTime;
+               if(unBytes > sResult.MaximumResyncBytes) {
+                  sResult.MaximumResyncBytes = unBytes;
+               }
+               if(unTime > sResult.MaximumResyncTime) {
+                  sResult.MaximumResyncTime = unTime;
+               }
+            }
+         }
+      }
+   }
+   return sResult;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+static int Report(const char* pch_path, uint32_t un_passes) {
+   CCapture cCapture;
+   if(!cCapture.Load(pch_path)) {
+      fprintf(stderr, "could not read %s\n", pch_path);
+      return EXIT_FAILURE;
+   }
+   CHUARTController& cController = CHUARTController::instance();
+   /* the first pass gives the statistics, all passes give the throughput */
+   SReplayResult sResult;
+   uint64_t unFrames = 0;
+   auto tStart = std::chrono::steady_clock::now();
+   uint64_t unStartCycles = ReadCycles();
+   for(uint32_t unPass = 0; unPass < un_passes; unPass++) {
+      CPacketControlInterface cInterface(cController);
+      SReplayResult sPassResult = Replay(cCapture, cInterface);
+      unFrames += sPassResult.Frames;
+      if(unPass == 0) {
+         sResult = sPassResult;
+      }
+   }
+   uint64_t unCycles = ReadCycles() - unStartCycles;
+   double fHostTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+   uint32_t unByteCount = cCapture.GetByteCount();
+   double fCaptureTime = cCapture.GetRecords().empty() ? 0.0 : cCapture.GetRecords().back().Time / 1e6;
+   CHUARTController::SStatistics sLinkStatistics = cController.GetStatistics();
+
+   printf("%s: %" PRIu32 " bytes in %zu records over %.1f s\n",
+          pch_path, unByteCount, cCapture.GetRecords().size(), fCaptureTime);
+   printf("   frames: %" PRIu32, sResult.Frames);
+   if(cCapture.GetValidFrames() != 0) {
+      printf(" of %" PRIu32 " valid, dropped-frame rate %.3f%%", cCapture.GetValidFrames(),
+             100.0 * (1.0 - double(sResult.Frames) / cCapture.GetValidFrames()));
+   }
+   printf("\n   parser: %" PRIu32 " checksum errors, %" PRIu32 " resyncs, %" PRIu32 " discarded bytes, "
+          "receive ring drops %u\n", sResult.ChecksumErrors, sResult.Resyncs, sResult.DiscardedBytes,
+          sLinkStatistics.RxDrops);
+   if(sResult.Losses != 0) {
+      printf("   resync latency: mean %.1f bytes / %.0f us, maximum %" PRIu32 " bytes / %" PRIu32
+             " us over %" PRIu32 " losses of synchronization\n",
+             double(sResult.ResyncBytes) / sResult.Losses,
+             double(sResult.ResyncTime) / sResult.Losses,
+             sResult.MaximumResyncBytes, sResult.MaximumResyncTime, sResult.Losses);
+   }
+   printf("   host: %" PRIu32 " passes in %.3f s, %.0f frames/s, %.1f MB/s",
+          un_passes, fHostTime, unFrames / fHostTime,
+          double(unByteCount) * un_passes / fHostTime / 1e6);
+#if defined(__x86_64__) || defined(__i386__)
+   printf(", %.1f cycles/byte", double(unCycles) / (double(unByteCount) * un_passes));
+#endif
+   printf("\n");
+   return EXIT_SUCCESS;
+}
+
+/***********************************************************/
+/***********************************************************/
+
+int main(int n_argc, char* ppch_argv[]) {
+   const char* pchGenerate = nullptr;
+   uint32_t unFrames = 10000;
+   uint32_t unPercent = 10;
+   const char* pchKinds = "ntfc";
+   uint32_t unSeed = 1;
+   uint32_t unBaudRate = 57600;
+   uint32_t unPasses = 1;
+   int nOption;
+   while((nOption = getopt(n_argc, ppch_argv, "g:n:p:k:s:b:r:")) != -1) {
+      switch(nOption) {
+      case 'g': pchGenerate = optarg; break;
+      case 'n': unFrames = strtoul(optarg, nullptr, 0); break;
+      case 'p': unPercent = strtoul(optarg, nullptr, 0); break;
+      case 'k': pchKinds = optarg; break;
+      case 's': unSeed = strtoul(optarg, nullptr, 0); break;
+      case 'b': unBaudRate = strtoul(optarg, nullptr, 0); break;
+      case 'r': unPasses = strtoul(optarg, nullptr, 0); break;
+      default:
+         fprintf(stderr, "usage: %s [-r passes] <capture>...\n"
+                         "       %s -g <capture> [-n frames] [-p percent] [-k kinds] [-s seed] [-b baud]\n",
+                 ppch_argv[0], ppch_argv[0]);
+         return EXIT_FAILURE;
+      }
+   }
+   if(pchGenerate != nullptr) {
+      if(unBaudRate == 0) {
+         fprintf(stderr, "the baud rate must not be zero\n");
+         return EXIT_FAILURE;
+      }
+      if(pchKinds[strspn(pchKinds, "ntfca")] != '\0' || pchKinds[0] == '\0') {
+         fprintf(stderr, "the kinds of impairments are letters of ntfca\n");
+         return EXIT_FAILURE;
+      }
+      return Generate(pchGenerate, unFrames, unPercent, pchKinds, unSeed, unBaudRate);
+   }
+   if(unPasses == 0) {
+      unPasses = 1;
+   }
+   int nResult = EXIT_SUCCESS;
+   for(int nIdx = optind; nIdx < n_argc; nIdx++) {
+      if(Report(ppch_argv[nIdx], unPasses) != EXIT_SUCCESS) {
+         nResult = EXIT_FAILURE;
+      }
+   }
+   return nResult;
+}
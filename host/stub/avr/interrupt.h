@@ -0,0 +1,14 @@
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+/* Interrupts become plain functions with C linkage so that the replay tool can
+   call them, e.g. USART_RX_vect() after writing a byte to UDR0. Nothing runs
+   concurrently on the host, so cli() and sei() do nothing */
+#define ISR(vector, ...) extern "C" void vector(void)
+
+inline void cli() {}
+inline void sei() {}
+
+#endif
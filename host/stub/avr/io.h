@@ -0,0 +1,58 @@
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+/* Host stand-in for the ATmega328P registers that the serial link uses. Each
+   register is a plain variable, the replay tool writes UCSR0A and UDR0 before
+   calling the receive interrupt and reads UDR0 after calling the transmit
+   interrupt. The variables are weak so that every translation unit shares them */
+
+#define HOST_REGISTER(type, name) \
+   __attribute__((weak)) volatile type host_##name
+
+HOST_REGISTER(uint8_t, SREG);
+HOST_REGISTER(uint8_t, UBRR0H);
+HOST_REGISTER(uint8_t, UBRR0L);
+HOST_REGISTER(uint8_t, UCSR0A);
+HOST_REGISTER(uint8_t, UCSR0B);
+HOST_REGISTER(uint8_t, UCSR0C);
+HOST_REGISTER(uint8_t, UDR0);
+HOST_REGISTER(uint16_t, TCNT1);
+HOST_REGISTER(uint8_t, TCNT2);
+HOST_REGISTER(uint8_t, TIFR1);
+HOST_REGISTER(uint8_t, TIFR2);
+
+#define SREG   host_SREG
+#define UBRR0H host_UBRR0H
+#define UBRR0L host_UBRR0L
+#define UCSR0A host_UCSR0A
+#define UCSR0B host_UCSR0B
+#define UCSR0C host_UCSR0C
+#define UDR0   host_UDR0
+#define TCNT1  host_TCNT1
+#define TCNT2  host_TCNT2
+#define TIFR1  host_TIFR1
+#define TIFR2  host_TIFR2
+
+/* UCSR0A */
+#define RXC0   7
+#define TXC0   6
+#define UDRE0  5
+#define FE0    4
+#define DOR0   3
+#define UPE0   2
+#define U2X0   1
+/* UCSR0B */
+#define RXCIE0 7
+#define TXCIE0 6
+#define UDRIE0 5
+#define RXEN0  4
+#define TXEN0  3
+/* TIFR1 and TIFR2 */
+#define OCF1A  1
+#define TOV2   0
+
+#define _BV(bit) (1 << (bit))
+
+#endif